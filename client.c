@@ -6,8 +6,14 @@
 #include <netdb.h>
 
 #define BUFFER_SIZE 1024
+#define MAX_SESSIONS 256
 
-int total_resources = 0;
+// Nombre de sessions logiques multiplexées sur la connexion (1 = protocole sans préfixe)
+int sessions_count = 1;
+// Ressources allouées à chaque session logique
+int total_resources[MAX_SESSIONS];
+// Intervalle en secondes entre deux battements de cœur pendant l'attente (0 = désactivé)
+int heartbeat = 0;
 
 // Méthode permettant d'afficher le message d'erreur d'utilisation du programme
 void usage(const char *prog_name) {
@@ -71,6 +77,15 @@ void envoyer_commande(int socket, const char *commande) {
     }
 }
 
+// Méthode permettant d'écrire une commande destinée à une session logique ("@<session> <commande>\n" si plusieurs sessions)
+void formater_commande(char *buffer, int session, const char *commande) {
+    if (sessions_count > 1) {
+        snprintf(buffer, BUFFER_SIZE, "@%d %s\n", session, commande);
+    } else {
+        snprintf(buffer, BUFFER_SIZE, "%s", commande);
+    }
+}
+
 // Méthode permettant de recevoir une réponse du serveur et la retourner
 char *recevoir_reponse(int socket) {
     char buffer[BUFFER_SIZE];
@@ -92,39 +107,59 @@ char *recevoir_reponse(int socket) {
     buffer[bytes_received] = '\0';
     printf("Réponse du serveur: \"%s\"\n", buffer);
 
-    return strdup(buffer);
+    // Retirer le préfixe de session et la fin de ligne
+    char *reponse = buffer;
+    if (reponse[0] == '@' && strchr(reponse, ' ') != NULL) {
+        reponse = strchr(reponse, ' ') + 1;
+    }
+    reponse[strcspn(reponse, "\r\n")] = '\0';
+
+    return strdup(reponse);
 }
 
 // Méthode permettant de faire une demande de libération de ressource au serveur
-void liberer_ressource(int socket, int taille) {
+void liberer_ressource(int socket, int session, int taille) {
+    char commande[64];
     char buffer[BUFFER_SIZE];
-    snprintf(buffer, BUFFER_SIZE, "RELEASE %d", taille);
+    snprintf(commande, sizeof(commande), "RELEASE %d", taille);
+    formater_commande(buffer, session, commande);
     envoyer_commande(socket, buffer);
     char *reponse = recevoir_reponse(socket);
     int ressource_liberee;
     if (sscanf(reponse, "RELEASED %d", &ressource_liberee) == 1) {
         printf("Ressource libérée: %d\n", ressource_liberee);
-        total_resources -= ressource_liberee;
+        total_resources[session] -= ressource_liberee;
     }
+
+    // Libérer la mémoire allouée pour la réponse
+    free(reponse);
 }
 
 // Méthode permettant de faire une demande de ressource au serveur
-void demander_ressource(int socket, int taille) {
+void demander_ressource(int socket, int session, int taille) {
+    char commande[64];
     char buffer[BUFFER_SIZE];
-    snprintf(buffer, BUFFER_SIZE, "REQUEST %d", taille);
+    snprintf(commande, sizeof(commande), "REQUEST %d", taille);
+    formater_commande(buffer, session, commande);
     envoyer_commande(socket, buffer);
     char *reponse = recevoir_reponse(socket);
     int ressource_allouee;
     char erreur[BUFFER_SIZE];
     if (sscanf(reponse, "GRANTED %d", &ressource_allouee) == 1) {
         printf("Ressource allouée: %d\n", ressource_allouee);
-        total_resources += ressource_allouee;
+        total_resources[session] += ressource_allouee;
+
+        // En mode identifiants, le serveur précise les identifiants attribués
+        char *identifiants = strstr(reponse, " IDS ");
+        if (identifiants != NULL) {
+            printf("Identifiants alloués: %s\n", identifiants + 5);
+        }
     } else if (sscanf(reponse, "DENIED %d, REASON: %[^\n]", &ressource_allouee, erreur) == 2) {
         printf("Ressource refusée: %d, raison: %s\n", ressource_allouee, erreur);
 
         // Dans le cas où la ressource est refusée, on fait une demande de libération de ressource
-        if (total_resources > 0) {
-            liberer_ressource(socket, taille);
+        if (total_resources[session] > 0) {
+            liberer_ressource(socket, session, taille);
         }
     }
 
@@ -132,11 +167,27 @@ void demander_ressource(int socket, int taille) {
     free(reponse);
 }
 
+// Méthode permettant de signaler au serveur que la connexion est toujours active
+void envoyer_battement(int socket) {
+    char buffer[BUFFER_SIZE];
+    formater_commande(buffer, 0, "PING");
+    envoyer_commande(socket, buffer);
+    char *reponse = recevoir_reponse(socket);
+    if (strcmp(reponse, "PONG") != 0) {
+        printf("Réponse inattendue au battement de cœur: %s\n", reponse);
+    }
+
+    // Libérer la mémoire allouée pour la réponse
+    free(reponse);
+}
+
 // --- config.txt ---
 //server_address=127.0.0.1
 //server_port=12345
 //resource_amount=2
 //delay=2
+//sessions=1
+//heartbeat=0
 
 // Méthode permettant de lire un fichier de configuration
 void lireFichierConfig(const char *fichier, char **server_address, int *server_port, int *resource_amount, int *delay) {
@@ -159,6 +210,10 @@ void lireFichierConfig(const char *fichier, char **server_address, int *server_p
                 *resource_amount = atoi(valeur);
             } else if (strcmp(clef, "delay") == 0) {
                 *delay = atoi(valeur);
+            } else if (strcmp(clef, "sessions") == 0) {
+                sessions_count = atoi(valeur);
+            } else if (strcmp(clef, "heartbeat") == 0) {
+                heartbeat = atoi(valeur);
             }
         }
     }
@@ -186,21 +241,38 @@ int main(int argc, char *argv[]) {
         lireFichierConfig(argv[1], &server_address, &server_port, &resource_amount, &delay);
     }
 
+    if (sessions_count < 1 || sessions_count > MAX_SESSIONS) {
+        fprintf(stderr, "Le nombre de sessions doit être compris entre 1 et %d\n", MAX_SESSIONS);
+        exit(EXIT_FAILURE);
+    }
+
     int sock;
 
     // Créer une socket
     sock = socket_client(server_address, server_port);
 
     for (;;) {
-        // Envoyer une demande de ressource au serveur
-        demander_ressource(sock, resource_amount);
+        // Envoyer une demande de ressource au serveur pour chaque session logique
+        for (int session = 0; session < sessions_count; session++) {
+            demander_ressource(sock, session, resource_amount);
 
-        // Afficher le total des ressources allouées
-        printf("Total des ressources allouées: %d\n", total_resources);
+            // Afficher le total des ressources allouées
+            printf("Total des ressources allouées (session %d): %d\n", session, total_resources[session]);
+        }
 
         // Attendre le délai spécifié avant d'envoyer la prochaine demande
         printf("Attente de %d secondes avant la prochaine demande...\n", delay);
-        sleep(delay);
+        if (heartbeat <= 0) {
+            sleep(delay);
+            continue;
+        }
+        // Envoyer un battement de cœur à chaque intervalle pour ne pas être jugé inactif par le serveur
+        for (int restant = delay; restant > 0; restant -= heartbeat) {
+            sleep(restant < heartbeat ? restant : heartbeat);
+            if (restant > heartbeat) {
+                envoyer_battement(sock);
+            }
+        }
     }
 
     // Fermer la socket
@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include "trace.h"
+
+#define BUFFER_SIZE 1024
+#define MAX_SESSIONS 1024
+
+// Objet permettant de stocker une connexion rejouée
+typedef struct {
+    int client_id;
+    int socket;   // -1 si la connexion est fermée et la session en attente de reprise
+    int prefixe;  // Session logique "@<prefixe>" partageant la connexion d'un autre client, 0 pour la session par défaut
+    int attendu;  // Ressources détenues d'après la trace
+    int obtenu;   // Ressources détenues d'après les réponses du serveur
+    uint64_t session_token;
+} ConnexionRejouee;
+
+// Méthode permettant d'afficher le message d'erreur d'utilisation du programme
+void usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s <trace_file> <server_address> <server_port> [speed]\n  speed: 1 = vitesse d'origine (défaut), 10 = 10 fois plus rapide, 0 = sans attente\n", prog_name);
+    exit(EXIT_FAILURE);
+}
+
+// Méthode permettant de récupérer l'horloge monotone en nanosecondes
+uint64_t horodatage_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Méthode permettant de créer une socket client et de se connecter à un serveur
+int socket_client(const char *address, int port) {
+    int client_socket;
+    struct sockaddr_in serveur_sockaddr;
+    struct hostent *hostent;
+
+    if ((hostent = gethostbyname(address)) == NULL) {
+        perror("Erreur lors de la résolution du nom d'hôte");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((client_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+        perror("Échec de la création de la socket");
+        exit(EXIT_FAILURE);
+    }
+
+    // Configuration de l'adresse du serveur
+    memset(&serveur_sockaddr, 0, sizeof(serveur_sockaddr));
+    serveur_sockaddr.sin_family = AF_INET;
+    serveur_sockaddr.sin_port = htons(port);
+    memcpy(&serveur_sockaddr.sin_addr, hostent->h_addr_list[0], hostent->h_length);
+
+    if (connect(client_socket, (struct sockaddr*)&serveur_sockaddr, sizeof(serveur_sockaddr)) == -1) {
+        perror("Erreur lors de l'appel de connect()");
+        exit(EXIT_FAILURE);
+    }
+
+    return client_socket;
+}
+
+// Méthode permettant d'envoyer une commande et d'attendre la réponse du serveur, retourne true si elle est acceptée
+bool envoyer_commande(const ConnexionRejouee *connexion, const char *texte, char *buffer) {
+    char commande[BUFFER_SIZE];
+    if (connexion->prefixe != 0) {
+        snprintf(commande, BUFFER_SIZE, "@%d %s", connexion->prefixe, texte);
+    } else {
+        snprintf(commande, BUFFER_SIZE, "%s", texte);
+    }
+
+    if (send(connexion->socket, commande, strlen(commande), 0) < 0) {
+        perror("Échec de l'envoi");
+        exit(EXIT_FAILURE);
+    }
+
+    int bytes_received = recv(connexion->socket, buffer, BUFFER_SIZE - 1, 0);
+    if (bytes_received <= 0) {
+        fprintf(stderr, "Le serveur a fermé la connexion\n");
+        exit(EXIT_FAILURE);
+    }
+    buffer[bytes_received] = '\0';
+
+    // Retirer le préfixe de session de la réponse
+    if (buffer[0] == '@') {
+        char *reponse = strchr(buffer, ' ');
+        if (reponse != NULL) {
+            memmove(buffer, reponse + 1, strlen(reponse));
+        }
+    }
+
+    return strncmp(buffer, "GRANTED", 7) == 0 || strncmp(buffer, "RELEASED", 8) == 0 || strncmp(buffer, "RESUMED", 7) == 0 || strncmp(buffer, "SESSION", 7) == 0 || strncmp(buffer, "CLOSED", 6) == 0;
+}
+
+// Méthode permettant de retrouver une connexion rejouée par l'identifiant du client de la trace
+ConnexionRejouee *get_connexion(ConnexionRejouee *connexions, int nombre, int client_id) {
+    for (int i = 0; i < nombre; i++) {
+        if (connexions[i].client_id == client_id) {
+            return &connexions[i];
+        }
+    }
+    return NULL;
+}
+
+// Méthode permettant d'attendre jusqu'à une date de l'horloge monotone
+void attendre_jusqua(uint64_t echeance_ns) {
+    uint64_t maintenant = horodatage_ns();
+    if (echeance_ns > maintenant) {
+        uint64_t attente = echeance_ns - maintenant;
+        struct timespec ts = { attente / 1000000000ULL, attente % 1000000000ULL };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Méthode principale du programme
+int main(int argc, char *argv[]) {
+    if (argc != 4 && argc != 5) {
+        usage(argv[0]);
+    }
+
+    const char *fichier = argv[1];
+    const char *server_address = argv[2];
+    int server_port = atoi(argv[3]);
+    double vitesse = argc == 5 ? atof(argv[4]) : 1.0;
+
+    EnTeteTrace entete;
+    long nombre_evenements;
+    EvenementTrace *evenements = lire_trace(fichier, &entete, &nombre_evenements);
+    uint64_t *latences = malloc(nombre_evenements * sizeof(uint64_t));
+    if (latences == NULL) {
+        fprintf(stderr, "Erreur lors de l'allocation des latences\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Les jetons de session ne sont demandés que si la trace contient des reprises
+    bool avec_reprises = false;
+    for (long i = 0; i < nombre_evenements; i++) {
+        avec_reprises = avec_reprises || evenements[i].type == TRACE_RESUME;
+    }
+
+    printf("Rejeu de %ld évènements vers %s:%d (capacité attendue du serveur %d, mode %s)...\n", nombre_evenements, server_address, server_port, entete.resource_amount, entete.mode_identifiants ? "identifiants" : "quantités");
+
+    ConnexionRejouee connexions[MAX_SESSIONS];
+    int nombre_connexions = 0;
+    int operations = 0;
+    int divergences = 0;
+    // Nombre de divergences au premier redimensionnement (-1 si la trace n'en contient pas)
+    int divergences_avant_redimensionnement = -1;
+
+    uint64_t origine_trace = nombre_evenements > 0 ? evenements[0].timestamp_ns : 0;
+    uint64_t debut_rejeu = horodatage_ns();
+    for (long i = 0; i < nombre_evenements; i++) {
+        EvenementTrace *evenement = &evenements[i];
+
+        // Respecter l'espacement d'origine des évènements, accéléré par 'vitesse'
+        if (vitesse > 0) {
+            attendre_jusqua(debut_rejeu + (uint64_t)((evenement->timestamp_ns - origine_trace) / vitesse));
+        }
+
+        uint64_t debut = horodatage_ns();
+        bool resultat = true;
+        char reponse[BUFFER_SIZE];
+        ConnexionRejouee *connexion = get_connexion(connexions, nombre_connexions, evenement->client_id);
+
+        if (evenement->type == TRACE_RESIZE) {
+            // La capacité d'un serveur distant ne peut pas être modifiée d'ici : les résultats suivants peuvent diverger
+            printf("Redimensionnement non rejoué: capacité %d dans la trace\n", evenement->amount);
+            if (divergences_avant_redimensionnement < 0) {
+                divergences_avant_redimensionnement = divergences;
+            }
+            continue;
+        } else if (evenement->type == TRACE_CONNECT) {
+            if (nombre_connexions == MAX_SESSIONS) {
+                divergences++;
+                continue;
+            }
+            // Une session logique partage la connexion de la session 0 du même client
+            ConnexionRejouee *proprietaire = get_connexion(connexions, nombre_connexions, evenement->amount);
+            connexion = &connexions[nombre_connexions++];
+            if (evenement->amount != 0 && proprietaire != NULL && proprietaire->socket >= 0) {
+                *connexion = (ConnexionRejouee){ evenement->client_id, proprietaire->socket, evenement->client_id, 0, 0, 0 };
+            } else {
+                *connexion = (ConnexionRejouee){ evenement->client_id, socket_client(server_address, server_port), 0, 0, 0, 0 };
+            }
+            if (avec_reprises && envoyer_commande(connexion, "SESSION", reponse)) {
+                sscanf(reponse, "SESSION %" SCNx64, &connexion->session_token);
+            }
+        } else if (evenement->type == TRACE_DISCONNECT && (evenement->flags & TRACE_FLAG_CLOSE)) {
+            // Fermeture explicite d'une session logique, la connexion reste ouverte
+            if (connexion != NULL) {
+                if (connexion->socket >= 0) {
+                    resultat = envoyer_commande(connexion, "CLOSE", reponse);
+                }
+                *connexion = connexions[--nombre_connexions];
+            }
+        } else if (evenement->type == TRACE_DISCONNECT || evenement->type == TRACE_EXPIRE) {
+            if (connexion != NULL) {
+                // Fermer la connexion : les sessions logiques qui la partagent la perdent aussi
+                if (connexion->socket >= 0 && evenement->type == TRACE_DISCONNECT) {
+                    int socket = connexion->socket;
+                    close(socket);
+                    for (int j = 0; j < nombre_connexions; j++) {
+                        if (connexions[j].socket == socket) {
+                            connexions[j].socket = -1;
+                        }
+                    }
+                }
+
+                // Le serveur conserve la session : garder ses soldes jusqu'à la reprise ou l'expiration
+                if (!(evenement->flags & TRACE_FLAG_GRACE)) {
+                    *connexion = connexions[--nombre_connexions];
+                }
+            }
+        } else if (evenement->type == TRACE_RESUME) {
+            ConnexionRejouee *session = get_connexion(connexions, nombre_connexions, evenement->amount);
+            if (connexion == NULL || connexion->socket < 0) {
+                divergences++;
+                continue;
+            }
+
+            // Une reprise refusée dans la trace est rejouée avec un jeton invalide (0)
+            char commande[BUFFER_SIZE];
+            snprintf(commande, BUFFER_SIZE, "RESUME %016" PRIx64, session != NULL ? session->session_token : 0);
+            resultat = envoyer_commande(connexion, commande, reponse);
+
+            // Transférer les soldes de la session reprise
+            if (session != NULL) {
+                if (evenement->result) {
+                    connexion->attendu += session->attendu;
+                }
+                if (resultat) {
+                    connexion->obtenu += session->obtenu;
+                    connexion->session_token = session->session_token;
+                }
+                if (evenement->result || resultat) {
+                    *session = connexions[--nombre_connexions];
+                }
+            }
+        } else {
+            // Une libération par liste renvoie exactement les plages enregistrées à sa suite
+            char demandes[BUFFER_SIZE];
+            bool avec_liste = evenement->type == TRACE_RELEASE && (evenement->flags & TRACE_FLAG_LISTE);
+            if (avec_liste) {
+                i = lire_plages_trace(evenements, nombre_evenements, i, demandes, sizeof(demandes));
+            }
+            if (connexion == NULL || connexion->socket < 0) {
+                divergences++;
+                continue;
+            }
+            bool demande = evenement->type == TRACE_REQUEST;
+            char commande[BUFFER_SIZE];
+            if (avec_liste) {
+                snprintf(commande, BUFFER_SIZE, "RELEASE %d IDS %s", evenement->amount, demandes);
+            } else {
+                snprintf(commande, BUFFER_SIZE, "%s %d%s", demande ? "REQUEST" : "RELEASE", evenement->amount, evenement->flags & TRACE_FLAG_CONTIGU ? " CONTIGUOUS" : "");
+            }
+            resultat = envoyer_commande(connexion, commande, reponse);
+
+            // Soldes attendu (d'après la trace) et obtenu (d'après le serveur)
+            int variation = demande ? evenement->amount : -evenement->amount;
+            if (evenement->result) {
+                connexion->attendu += variation;
+            }
+            if (resultat) {
+                connexion->obtenu += variation;
+            }
+        }
+
+        latences[operations++] = horodatage_ns() - debut;
+        if (resultat != (bool)evenement->result) {
+            divergences++;
+        }
+    }
+    uint64_t duree = horodatage_ns() - debut_rejeu;
+
+    // Comparer l'état final à celui attendu d'après la trace, puis fermer les connexions restantes
+    bool etat_equivalent = true;
+    for (int i = 0; i < nombre_connexions; i++) {
+        if (connexions[i].attendu != connexions[i].obtenu) {
+            etat_equivalent = false;
+        }
+        if (connexions[i].socket >= 0 && connexions[i].prefixe == 0) {
+            close(connexions[i].socket);
+        }
+    }
+
+    afficher_rapport_rejeu(latences, operations, duree, divergences, etat_equivalent);
+    if (divergences_avant_redimensionnement >= 0) {
+        printf("Dont divergences après un redimensionnement non rejoué: %d\n", divergences - divergences_avant_redimensionnement);
+    }
+
+    free(evenements);
+    free(latences);
+    return 0;
+}
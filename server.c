@@ -17,31 +17,201 @@
 #include <time.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <stdint.h>
+#include <poll.h>
+#include <inttypes.h>
+#include <sys/random.h>
+#include <ctype.h>
+#include <limits.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "trace.h"
 
 #define BUFFER_SIZE 1024
 #define MAX_CLIENTS 100
+#define MAX_SESSIONS 1024
+#define MAX_SESSIONS_PAR_CONNEXION 256 // Borne de l'option max_sessions_per_connection
+#define MAX_SESSIONS_LOGIQUES (MAX_SESSIONS - MAX_CLIENTS) // Le reste du registre est réservé aux sessions 0 des connexions
 #define SEM_RESSOURCES_NAME "/sem_ressources"
 #define SHM_RESSOURCES_AVAILABLE_NAME "/shm_ressources_available"
 #define SHM_CLIENTS_NAME "/shm_clients"
+#define SHM_IDENTIFIANTS_NAME "/shm_identifiants"
+#define SHM_TIMERS_NAME "/shm_timers"
+#define MAX_TIMERS (MAX_SESSIONS + MAX_CLIENTS) // Une échéance de grâce par emplacement de session, une d'inactivité par connexion
+#define SHM_DEBITS_NAME "/shm_debits"
+#define DEBITS_IP_SLOTS (1 << 18)
+#define DEBITS_IP_MAX_PROBES 32
+#define MAX_RAFALE ((int)(UINT32_MAX / 1000)) // Rafale maximale d'un seau à jetons (jetons en millièmes sur 32 bits)
+#define MAX_RESOURCE_IDS 65536
+#define TAILLE_LISTE_PLAGES (BUFFER_SIZE - 32) // Place laissée aux plages dans une réponse "GRANTED <n> ..." ou "RELEASED <n> ..."
+#define BITMAP_WORDS (MAX_RESOURCE_IDS / 64)
+#define BITMAP_SUMMARY_WORDS (BITMAP_WORDS / 64)
 
 // Objet permettant de stocker les informations d'un client
 typedef struct {
     int client_pid;
+    int client_id;
+    int session_id;             // Session logique de la connexion (0 = session par défaut, sans préfixe "@<id>")
     int resources_using;
     char client_ip[INET_ADDRSTRLEN];
     int client_port;
+    uint64_t session_token;     // Jeton permettant de reprendre la session depuis une nouvelle connexion
+    bool connected;             // false : connexion perdue, ressources conservées pendant le délai de grâce
+    uint64_t grace_deadline_ns; // Fin du délai de grâce (horloge CLOCK_MONOTONIC)
 } ClientInfo;
 
+// Objet permettant de stocker l'activité d'une connexion TCP, surveillée par le processus des timers
+typedef struct {
+    int pid;                   // Processus fils de la connexion (0 = emplacement libre, -1 = fork en cours)
+    uint32_t generation;       // Incrémentée à chaque réservation : distingue les échéances d'une connexion précédente
+    uint64_t last_activity_ns; // Dernière commande reçue (horloge CLOCK_MONOTONIC), écrite sans verrou par le fils
+} ConnexionInfo;
+
 // Objet permettant de stocker les informations des clients
+// Un client garde son emplacement jusqu'à son retrait (client_id = 0 : emplacement libre) : les pointeurs
+// obtenus par get_client_by_id restent valides même si d'autres clients sont retirés entre-temps
 typedef struct {
     int clients_count;
-    ClientInfo clients[MAX_CLIENTS];
+    int clients_limit;     // Indice du dernier emplacement occupé + 1
+    int sessions_logiques_count; // Clients dont la session_id n'est pas 0, limités à MAX_SESSIONS_LOGIQUES
+    int connections_count; // Connexions TCP ouvertes (une connexion peut porter plusieurs sessions logiques)
+    int next_client_id;
+    ClientInfo clients[MAX_SESSIONS];
+    ConnexionInfo connections[MAX_CLIENTS];
     sem_t semaphore;
 } ArrayListClientInfo;
 
+// Objet permettant de stocker une session logique d'une connexion (propre au processus fils)
+typedef struct {
+    int session_id;
+    int client_id;
+    uint64_t seau; // Seau à jetons de la session
+} SessionLogique;
+
+// Objet permettant de stocker les octets reçus d'une connexion qui ne forment pas encore une commande complète
+typedef struct {
+    char data[BUFFER_SIZE];
+    int length;
+    bool mode_lignes; // true dès que le client termine ses commandes par '\n'
+} TamponReception;
+
+// Objet permettant de stocker une commande reçue et la façon d'y répondre
+typedef struct {
+    char *texte;     // Commande sans le préfixe de session
+    int session_id;
+    bool prefixe;    // La commande était préfixée par "@<id>" : la réponse l'est aussi
+    bool ligne;      // La commande était terminée par '\n' : la réponse l'est aussi
+} CommandeClient;
+
+// Types d'échéances gérées par le processus des timers
+enum {
+    TIMER_GRACE = 1,
+    TIMER_INACTIVITE = 2
+};
+
+// Objet permettant de stocker une échéance
+typedef struct {
+    uint64_t deadline_ns; // Horloge CLOCK_MONOTONIC
+    int client_id;        // TIMER_INACTIVITE : emplacement de la connexion dans 'connections'
+    int type;
+    uint32_t generation;  // TIMER_INACTIVITE : génération de la connexion lors de l'armement
+    int cle;              // TIMER_GRACE : emplacement de la session, TIMER_INACTIVITE : MAX_SESSIONS + emplacement de la connexion
+} EntreeTimer;
+
+// Objet permettant de stocker toutes les échéances du serveur dans un tas binaire (la plus proche en tête)
+// Chaque clé a au plus une échéance : la réarmer la déplace, et une session reprise retire la sienne
+typedef struct {
+    int count;
+    EntreeTimer entries[MAX_TIMERS];
+    int positions[MAX_TIMERS]; // Indice dans 'entries' de l'échéance de chaque clé (-1 = aucune)
+    sem_t semaphore;
+    sem_t reveil; // Posté lorsqu'une échéance plus proche que la tête est ajoutée
+} TasTimers;
+
+// Objet permettant de stocker le seau à jetons d'une adresse IP (16 octets : 4 entrées par ligne de cache)
+// state : jetons disponibles en millièmes (32 bits de poids fort) | date du dernier remplissage en ms (32 bits de poids faible)
+typedef struct {
+    uint32_t ip; // 0 = entrée libre
+    uint32_t reserved;
+    uint64_t state;
+} EntreeDebitIP;
+
+// Objet permettant de stocker les seaux à jetons par adresse IP (table à adressage ouvert) et les compteurs de rejets
+typedef struct {
+    uint64_t rejets_session;    // Commandes rejetées par la limite de la session
+    uint64_t rejets_ip;         // Commandes rejetées par la limite de l'adresse IP
+    uint64_t rejets_connexion;  // Connexions rejetées par la limite de l'adresse IP
+    uint64_t ip_non_suivies;    // Adresses IP acceptées sans limite faute de place dans la table
+    uint64_t entrees_recyclees; // Entrées inutilisées réattribuées à une nouvelle adresse IP
+    EntreeDebitIP entries[DEBITS_IP_SLOTS];
+} TableDebits;
+
+// Objet permettant de stocker un ensemble d'identifiants sous forme de bitmap hiérarchique
+// words : un bit par identifiant, summary : un bit par mot de 'words' (1 = au moins un identifiant marqué)
+typedef struct {
+    uint64_t summary[BITMAP_SUMMARY_WORDS] __attribute__((aligned(32)));
+    uint64_t words[BITMAP_WORDS] __attribute__((aligned(32)));
+} BitmapIdentifiants;
+
+// Objet permettant de stocker les identifiants des ressources
+// detenus : identifiants de chaque client, indexés par son emplacement dans la liste des clients
+typedef struct {
+    int capacity;
+    BitmapIdentifiants libres;
+    BitmapIdentifiants detenus[MAX_SESSIONS];
+} PoolIdentifiants;
+
+// Objet permettant de stocker une plage d'identifiants [debut, debut + longueur[
+typedef struct {
+    int debut;
+    int longueur;
+} Plage;
+
+// Résultats d'une attribution ou d'une libération d'identifiants
+enum {
+    IDENTIFIANTS_OK = 0,
+    IDENTIFIANTS_REFUSES = 1,           // Ressources insuffisantes ou identifiants non détenus
+    IDENTIFIANTS_LISTE_TROP_LONGUE = 2  // Les plages ne tiendraient pas dans la réponse
+};
+
+// Objet permettant d'écrire une liste de plages dans une réponse de taille limitée
+typedef struct {
+    char *texte;
+    size_t taille;
+    size_t ecrit;      // Vaut 'taille' dès qu'une plage n'a pas tenu dans le texte
+    int nombre_plages;
+} ListePlages;
+
+// Objet permettant de stocker les options du serveur lues dans le fichier de configuration
+typedef struct {
+    bool mode_identifiants;
+    char trace_file[BUFFER_SIZE];
+    int session_grace; // Délai de grâce en secondes avant libération des ressources d'un client déconnecté (0 = désactivé)
+    int rate_session;  // Commandes par seconde autorisées par session (0 = illimité)
+    int rate_session_burst;
+    int rate_ip;       // Commandes et connexions par seconde autorisées par adresse IP (0 = illimité)
+    int rate_ip_burst;
+    int idle_timeout;  // Délai en secondes sans commande avant de considérer la connexion comme morte (0 = désactivé)
+    int max_sessions_per_connection; // Sessions (session 0 comprise) qu'une connexion peut ouvrir
+} OptionsServeur;
+
 // Variables globales
 int resources_amount;
 int server_sock;
+OptionsServeur options = { .mode_identifiants = false, .trace_file = "", .session_grace = 0, .rate_session = 0, .rate_session_burst = 0, .rate_ip = 0, .rate_ip_burst = 0, .idle_timeout = 0, .max_sessions_per_connection = 16 };
+
+// Descripteur de fichier de la trace (-1 si l'enregistrement est désactivé)
+int trace_fd = -1;
+// Horodatage relevé sous le verrou des ressources par la dernière opération du processus, repris par tracer() (0 si aucun)
+uint64_t horodatage_operation = 0;
+
+// Fichier de configuration à relire sur SIGHUP (NULL si le serveur est lancé sans fichier)
+const char *fichier_config = NULL;
+// Tube dans lequel le gestionnaire de SIGHUP écrit un octet, surveillé par la boucle principale avec la socket serveur
+int tube_rechargement[2] = { -1, -1 };
+// Positionné dans un fils par SIGUSR1 lorsque le processus des timers juge sa connexion inactive
+volatile sig_atomic_t inactivite_detectee = 0;
 
 // Sémaphore
 sem_t *semaphore_ressources;
@@ -60,9 +230,30 @@ void *shm_region_clients;
 // Variable partagée 'clients'
 ArrayListClientInfo *clients;
 
+// Descripteur de fichier de la mémoire partagée 'identifiants' (mode identifiants uniquement)
+int shm_fd_identifiants;
+// Pointeur pour l'association du segment de mémoire partagée 'identifiants' à un espace d'adressage du processus
+void *shm_region_identifiants;
+// Variable partagée 'identifiants'
+PoolIdentifiants *identifiants;
+
+// Descripteur de fichier de la mémoire partagée 'timers' (uniquement si des échéances sont utilisées)
+int shm_fd_timers;
+// Pointeur pour l'association du segment de mémoire partagée 'timers' à un espace d'adressage du processus
+void *shm_region_timers;
+// Variable partagée 'timers'
+TasTimers *timers;
+
+// Descripteur de fichier de la mémoire partagée 'débits' (uniquement si une limite de débit est configurée)
+int shm_fd_debits;
+// Pointeur pour l'association du segment de mémoire partagée 'débits' à un espace d'adressage du processus
+void *shm_region_debits;
+// Variable partagée 'débits'
+TableDebits *debits;
+
 // Méthode permettant d'afficher le message d'erreur d'utilisation du programme
 void usage(const char *prog_name) {
-    fprintf(stderr, "Usage: %s <resource_amount> <port>\nOR\nUsage: %s <config_file>\n", prog_name, prog_name);
+    fprintf(stderr, "Usage: %s <resource_amount> <port>\nOR\nUsage: %s <config_file>\nOR\nUsage: %s --replay <trace_file>\n", prog_name, prog_name, prog_name);
     exit(EXIT_FAILURE);
 }
 
@@ -90,6 +281,17 @@ void fermer_semaphore(sem_t *semaphore, const char *name) {
     }
 }
 
+// Méthode permettant de verrouiller un sémaphore, en reprenant l'attente si elle est interrompue par un signal
+// Sans cette reprise, un signal reçu pendant l'attente ferait entrer dans la section critique sans le verrou
+void verrouiller_semaphore(sem_t *semaphore) {
+    while (sem_wait(semaphore) == -1) {
+        if (errno != EINTR) {
+            perror("Erreur lors du verrouillage du sémaphore");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
 // Méthode permettant de créer un segment de mémoire partagée et de l'associer à un espace d'adressage du processus
 void creer_segment_memoire_partagee(int *shm_fd, void **shm_region, const char *name, int size) {
     // Création du segment de mémoire partagée
@@ -134,37 +336,69 @@ void fermer_segment_memoire_partagee(int *shm_fd, void **shm_region, const char
     }
 }
 
-// Méthode permettant d'ajouter un élément à l'array list
-void ajouter_client(ArrayListClientInfo *list, ClientInfo client) {
+// Méthode permettant d'ajouter un élément à l'array list, retourne l'identifiant attribué au client (0 si la liste est pleine)
+int ajouter_client(ArrayListClientInfo *list, ClientInfo client) {
     // Verrouiller le sémaphore
-    sem_wait(&list->semaphore);
+    verrouiller_semaphore(&list->semaphore);
 
-    // Ajouter le client à la liste des clients
-    list->clients[list->clients_count++] = client;
+    // Les sessions logiques ne peuvent pas occuper la place réservée aux sessions 0 des connexions
+    if (list->clients_count == MAX_SESSIONS || (client.session_id != 0 && list->sessions_logiques_count == MAX_SESSIONS_LOGIQUES)) {
+        // Déverrouiller le sémaphore
+        sem_post(&list->semaphore);
+        return 0;
+    }
+
+    // Attribuer au client un identifiant unique (contrairement au pid, jamais réutilisé)
+    client.client_id = ++list->next_client_id;
+
+    // Ajouter le client dans le premier emplacement libre
+    int i = 0;
+    while (list->clients[i].client_id != 0) {
+        i++;
+    }
+    list->clients[i] = client;
+    list->clients_count++;
+    if (client.session_id != 0) {
+        list->sessions_logiques_count++;
+    }
+    if (i >= list->clients_limit) {
+        list->clients_limit = i + 1;
+    }
     
     // Déverrouiller le sémaphore
     sem_post(&list->semaphore);
+
+    return client.client_id;
+}
+
+// Méthode permettant de retirer l'élément d'indice i de l'array list (sémaphore déjà verrouillé)
+void retirer_client_index(ArrayListClientInfo *list, int i) {
+    if (list->clients[i].session_id != 0) {
+        list->sessions_logiques_count--;
+    }
+    // Libérer l'emplacement sans décaler les autres clients
+    list->clients[i] = (ClientInfo){0};
+    // Décrémenter le nombre de clients
+    list->clients_count--;
+    while (list->clients_limit > 0 && list->clients[list->clients_limit - 1].client_id == 0) {
+        list->clients_limit--;
+    }
 }
 
 // Méthode permettant de retirer un élément de l'array list
 void retirer_client(ArrayListClientInfo *list, int client_pid) {
     // Verrouiller le sémaphore
-    sem_wait(&list->semaphore);
+    verrouiller_semaphore(&list->semaphore);
 
     // Rechercher le client par son pid, le retirer et décaler les éléments
     // Recherche du client
     int i = 0;
-    while (i < list->clients_count && list->clients[i].client_pid != client_pid) {
+    while (i < list->clients_limit && (list->clients[i].client_id == 0 || list->clients[i].client_pid != client_pid)) {
         i++;
     }
-    // Décaler les éléments
-    for (int j = i; j < list->clients_count - 1; j++) {
-        list->clients[j] = list->clients[j + 1];
+    if (i < list->clients_limit) {
+        retirer_client_index(list, i);
     }
-    // Supprimer dernier élément
-    list->clients[list->clients_count - 1] = (ClientInfo){0};
-    // Décrémenter le nombre de clients
-    list->clients_count--;
 
     // Déverrouiller le sémaphore
     sem_post(&list->semaphore);
@@ -173,11 +407,30 @@ void retirer_client(ArrayListClientInfo *list, int client_pid) {
 // Méthode permettant de récupérer le pointeur d'un client par son pid
 ClientInfo *get_client_by_pid(ArrayListClientInfo *list, int client_pid) {
     // Verrouiller le sémaphore
-    sem_wait(&list->semaphore);
+    verrouiller_semaphore(&list->semaphore);
 
     // Rechercher le client par son pid
-    for (int i = 0; i < list->clients_count; i++) {
-        if (list->clients[i].client_pid == client_pid) {
+    for (int i = 0; i < list->clients_limit; i++) {
+        if (list->clients[i].client_id != 0 && list->clients[i].client_pid == client_pid) {
+            // Déverrouiller le sémaphore
+            sem_post(&list->semaphore);
+            return &list->clients[i];
+        }
+    }
+
+    // Déverrouiller le sémaphore
+    sem_post(&list->semaphore);
+    return NULL;
+}
+
+// Méthode permettant de récupérer le pointeur d'un client par son identifiant
+ClientInfo *get_client_by_id(ArrayListClientInfo *list, int client_id) {
+    // Verrouiller le sémaphore
+    verrouiller_semaphore(&list->semaphore);
+
+    // Rechercher le client par son identifiant
+    for (int i = 0; i < list->clients_limit; i++) {
+        if (list->clients[i].client_id == client_id) {
             // Déverrouiller le sémaphore
             sem_post(&list->semaphore);
             return &list->clients[i];
@@ -189,18 +442,63 @@ ClientInfo *get_client_by_pid(ArrayListClientInfo *list, int client_pid) {
     return NULL;
 }
 
-// Méthode permettant de savoir combien de clients sont connectés
-int get_clients_count(ArrayListClientInfo *list) {
+// Méthode permettant de retirer un élément de l'array list par son identifiant
+void retirer_client_by_id(ArrayListClientInfo *list, int client_id) {
+    // Verrouiller le sémaphore
+    verrouiller_semaphore(&list->semaphore);
+
+    for (int i = 0; i < list->clients_limit; i++) {
+        if (list->clients[i].client_id == client_id) {
+            retirer_client_index(list, i);
+            break;
+        }
+    }
+
+    // Déverrouiller le sémaphore
+    sem_post(&list->semaphore);
+}
+
+// Méthode permettant de récupérer l'horloge monotone en nanosecondes
+uint64_t horodatage_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Méthode permettant de réserver une connexion, retourne son emplacement ou -1 si le nombre maximal de connexions est atteint
+int reserver_connexion(ArrayListClientInfo *list) {
     // Verrouiller le sémaphore
-    sem_wait(&list->semaphore);
+    verrouiller_semaphore(&list->semaphore);
 
-    // Récupérer le nombre de clients
-    int clients_count = list->clients_count;
+    int slot = -1;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (list->connections[i].pid == 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot >= 0) {
+        list->connections_count++;
+        list->connections[slot].pid = -1;
+        list->connections[slot].generation++;
+        list->connections[slot].last_activity_ns = horodatage_ns();
+    }
 
     // Déverrouiller le sémaphore
     sem_post(&list->semaphore);
+    return slot;
+}
+
+// Méthode permettant de libérer une connexion réservée
+void liberer_connexion(ArrayListClientInfo *list, int slot) {
+    // Verrouiller le sémaphore
+    verrouiller_semaphore(&list->semaphore);
+
+    list->connections_count--;
+    list->connections[slot].pid = 0;
 
-    return clients_count;
+    // Déverrouiller le sémaphore
+    sem_post(&list->semaphore);
 }
 
 // Méthode permettant de fermer une socket
@@ -214,10 +512,40 @@ void fermer_socket(int socket) {
     }
 }
 
+// Méthode permettant de créer le fichier de trace et d'y écrire l'en-tête
+void ouvrir_trace(const char *fichier, int resource_amount, bool mode_identifiants) {
+    // O_APPEND : les écritures des différents processus fils ne se chevauchent pas
+    trace_fd = open(fichier, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (trace_fd < 0) {
+        perror("Erreur lors de l'ouverture du fichier de trace");
+        exit(EXIT_FAILURE);
+    }
+
+    EnTeteTrace entete = {0};
+    memcpy(entete.magic, TRACE_MAGIC, sizeof(entete.magic));
+    entete.version = TRACE_VERSION;
+    entete.resource_amount = resource_amount;
+    entete.mode_identifiants = mode_identifiants;
+    if (write(trace_fd, &entete, sizeof(entete)) != sizeof(entete)) {
+        perror("Erreur lors de l'écriture de l'en-tête de trace");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Méthode permettant de verrouiller le sémaphore des ressources en datant l'opération pour la trace
+void verrouiller_ressources() {
+    verrouiller_semaphore(semaphore_ressources);
+
+    // Dater sous le verrou : l'ordre des horodatages est celui dans lequel les opérations ont été sérialisées
+    if (trace_fd >= 0) {
+        horodatage_operation = horodatage_ns();
+    }
+}
+
 // Méthode permettant de faire une demande de ressources
 bool changer_ressources_client(ClientInfo *clientInfo, int change_amount) {
     // Verrouiller le sémaphore des ressources
-    sem_wait(semaphore_ressources);
+    verrouiller_ressources();
 
     // CAS : Demande de ressources
     if (change_amount > 0) {
@@ -264,28 +592,859 @@ bool changer_ressources_client(ClientInfo *clientInfo, int change_amount) {
         sem_post(semaphore_ressources);
         return true;
     }
-}
+}
+
+// Méthode permettant de trouver le premier mot non nul d'un tableau de mots 64 bits à partir de 'debut' (retourne 'n' si aucun)
+// Les mots sont testés par blocs avec SIMD lorsque le processeur le permet
+int premier_mot_non_nul(const uint64_t *mots, int debut, int n) {
+    int i = debut;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256i bloc = _mm256_loadu_si256((const __m256i *)&mots[i]);
+        if (!_mm256_testz_si256(bloc, bloc)) {
+            break;
+        }
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        __m128i bloc = _mm_loadu_si128((const __m128i *)&mots[i]);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(bloc, _mm_setzero_si128())) != 0xFFFF) {
+            break;
+        }
+    }
+#endif
+    // Terminer (ou localiser le mot exact dans le bloc trouvé) mot par mot
+    for (; i < n; i++) {
+        if (mots[i] != 0) {
+            return i;
+        }
+    }
+    return n;
+}
+
+// Méthode permettant de trouver le premier identifiant marqué d'un bitmap à partir de 'debut' (retourne -1 si aucun)
+int premier_identifiant(const BitmapIdentifiants *bitmap, int debut) {
+    if (debut >= MAX_RESOURCE_IDS) {
+        return -1;
+    }
+
+    // Chercher dans le mot contenant 'debut'
+    int mot = debut / 64;
+    uint64_t bits = bitmap->words[mot] & (~0ULL << (debut % 64));
+    if (bits != 0) {
+        return mot * 64 + __builtin_ctzll(bits);
+    }
+
+    // Chercher le mot suivant ayant un identifiant marqué grâce au résumé
+    mot++;
+    if (mot >= BITMAP_WORDS) {
+        return -1;
+    }
+    int resume = mot / 64;
+    uint64_t bits_resume = bitmap->summary[resume] & (~0ULL << (mot % 64));
+    if (bits_resume == 0) {
+        resume = premier_mot_non_nul(bitmap->summary, resume + 1, BITMAP_SUMMARY_WORDS);
+        if (resume == BITMAP_SUMMARY_WORDS) {
+            return -1;
+        }
+        bits_resume = bitmap->summary[resume];
+    }
+    mot = resume * 64 + __builtin_ctzll(bits_resume);
+    return mot * 64 + __builtin_ctzll(bitmap->words[mot]);
+}
+
+// Méthode permettant de compter les identifiants marqués consécutifs à partir de 'debut' (au plus 'max')
+int longueur_plage(const BitmapIdentifiants *bitmap, int debut, int max) {
+    int longueur = 0;
+    int position = debut;
+    while (longueur < max && position < MAX_RESOURCE_IDS) {
+        int decalage = position % 64;
+        uint64_t absents = ~(bitmap->words[position / 64] >> decalage);
+        if (absents == 0) {
+            // Tout le reste du mot est marqué
+            longueur += 64 - decalage;
+            position += 64 - decalage;
+        } else {
+            int marques = __builtin_ctzll(absents);
+            if (marques > 64 - decalage) {
+                marques = 64 - decalage;
+            }
+            longueur += marques;
+            if (marques < 64 - decalage) {
+                break;
+            }
+            position += marques;
+        }
+    }
+    return longueur < max ? longueur : max;
+}
+
+// Méthode permettant de calculer le masque des bits d'une plage contenus dans le mot de 'position' (nombre : bits couverts)
+uint64_t masque_plage(int position, int fin, int *nombre) {
+    int decalage = position % 64;
+    *nombre = fin - position < 64 - decalage ? fin - position : 64 - decalage;
+    return (*nombre == 64 ? ~0ULL : ((1ULL << *nombre) - 1)) << decalage;
+}
+
+// Méthode permettant de marquer ou démarquer une plage d'identifiants (bitmap et résumé)
+void marquer_plage(BitmapIdentifiants *bitmap, Plage plage, bool marque) {
+    int position = plage.debut;
+    int fin = plage.debut + plage.longueur;
+    while (position < fin) {
+        int mot = position / 64;
+        int nombre;
+        uint64_t masque = masque_plage(position, fin, &nombre);
+
+        if (marque) {
+            bitmap->words[mot] |= masque;
+        } else {
+            bitmap->words[mot] &= ~masque;
+        }
+
+        // Mettre à jour le résumé
+        if (bitmap->words[mot] != 0) {
+            bitmap->summary[mot / 64] |= 1ULL << (mot % 64);
+        } else {
+            bitmap->summary[mot / 64] &= ~(1ULL << (mot % 64));
+        }
+
+        position += nombre;
+    }
+}
+
+// Méthode permettant de vérifier que tous les identifiants d'une plage sont marqués
+bool plage_marquee(const BitmapIdentifiants *bitmap, Plage plage) {
+    int position = plage.debut;
+    int fin = plage.debut + plage.longueur;
+    while (position < fin) {
+        int nombre;
+        uint64_t masque = masque_plage(position, fin, &nombre);
+        if ((bitmap->words[position / 64] & masque) != masque) {
+            return false;
+        }
+        position += nombre;
+    }
+    return true;
+}
+
+// Méthode permettant d'ajouter à 'destination' tous les identifiants marqués de 'source' puis de vider 'source'
+// Seuls les mots signalés par le résumé sont parcourus
+void transferer_identifiants(BitmapIdentifiants *source, BitmapIdentifiants *destination) {
+    for (int resume = 0; resume < BITMAP_SUMMARY_WORDS; resume++) {
+        uint64_t bits = source->summary[resume];
+        while (bits != 0) {
+            int mot = resume * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            destination->words[mot] |= source->words[mot];
+            source->words[mot] = 0;
+        }
+        destination->summary[resume] |= source->summary[resume];
+        source->summary[resume] = 0;
+    }
+}
+
+// Méthode permettant d'initialiser le pool d'identifiants avec les identifiants [0, capacity[ libres
+void initialiser_identifiants(PoolIdentifiants *pool, int capacity) {
+    memset(pool, 0, sizeof(PoolIdentifiants));
+    pool->capacity = capacity;
+    marquer_plage(&pool->libres, (Plage){0, capacity}, true);
+}
+
+// Méthode permettant de retrouver les identifiants détenus par un client (indexés par son emplacement dans la liste)
+BitmapIdentifiants *identifiants_detenus(const ClientInfo *clientInfo) {
+    return &identifiants->detenus[clientInfo - clients->clients];
+}
+
+// Méthode permettant de commencer une liste de plages "IDS a-b,c,d-e" dans 'liste'
+void commencer_liste(ListePlages *liste, char *texte, size_t taille) {
+    liste->texte = texte;
+    liste->taille = taille;
+    liste->ecrit = snprintf(texte, taille, "IDS ");
+    liste->nombre_plages = 0;
+}
+
+// Méthode permettant d'ajouter une plage à une liste, tant qu'elle tient dans le texte
+void ajouter_plage(ListePlages *liste, Plage plage) {
+    const char *separateur = liste->nombre_plages > 0 ? "," : "";
+    liste->nombre_plages++;
+    if (liste->ecrit >= liste->taille) {
+        return;
+    }
+
+    size_t reste = liste->taille - liste->ecrit;
+    int longueur;
+    if (plage.longueur == 1) {
+        longueur = snprintf(liste->texte + liste->ecrit, reste, "%s%d", separateur, plage.debut);
+    } else {
+        longueur = snprintf(liste->texte + liste->ecrit, reste, "%s%d-%d", separateur, plage.debut, plage.debut + plage.longueur - 1);
+    }
+    // Plage tronquée : le texte ne tient plus, la liste sera résumée
+    liste->ecrit = (size_t)longueur < reste ? liste->ecrit + longueur : liste->taille;
+}
+
+// Méthode permettant de savoir si une liste a dépassé la taille de son texte
+bool liste_trop_longue(const ListePlages *liste) {
+    return liste->ecrit >= liste->taille;
+}
+
+// Méthode permettant de vérifier, sans rien modifier, que les premières plages de 'bitmap' couvrant 'quantite'
+// identifiants tiennent dans une liste de 'taille' octets
+bool plages_tiennent(const BitmapIdentifiants *bitmap, int quantite, size_t taille) {
+    size_t ecrit = strlen("IDS ");
+    int restant = quantite;
+    int position = 0;
+    while (restant > 0) {
+        int debut = premier_identifiant(bitmap, position);
+        if (debut < 0) {
+            break;
+        }
+        int longueur = longueur_plage(bitmap, debut, restant);
+        ecrit += (position > 0 ? 1 : 0) + (longueur == 1 ? snprintf(NULL, 0, "%d", debut) : snprintf(NULL, 0, "%d-%d", debut, debut + longueur - 1));
+        if (ecrit >= taille) {
+            return false;
+        }
+        restant -= longueur;
+        position = debut + longueur;
+    }
+    return true;
+}
+
+// Méthode permettant de lire la plage suivante d'un texte "a-b,c,d-e"
+// Retourne 1 si une plage a été lue, 0 à la fin du texte, -1 si le texte est invalide
+int lire_plage(const char **curseur, Plage *plage) {
+    if (**curseur == '\0') {
+        return 0;
+    }
+
+    char *fin;
+    long debut = strtol(*curseur, &fin, 10);
+    if (fin == *curseur || debut < 0 || debut >= MAX_RESOURCE_IDS) {
+        return -1;
+    }
+    long dernier = debut;
+    if (*fin == '-') {
+        const char *suite = fin + 1;
+        dernier = strtol(suite, &fin, 10);
+        if (fin == suite || dernier < debut || dernier >= MAX_RESOURCE_IDS) {
+            return -1;
+        }
+    }
+    if (*fin == ',') {
+        fin++;
+    } else if (*fin != '\0') {
+        return -1;
+    }
+
+    *plage = (Plage){(int)debut, (int)(dernier - debut + 1)};
+    *curseur = fin;
+    return 1;
+}
+
+// Méthode permettant d'enregistrer un évènement et les plages d'identifiants qu'il désigne dans la trace (si elle est activée)
+// L'évènement porte l'horodatage de l'opération relevé sous le verrou, l'écriture pouvant avoir lieu après sa libération
+// Si 'plages' n'est pas NULL, les plages "a-b,c" qu'il désigne suivent l'évènement (TRACE_PLAGE, même horodatage) : un seul
+// appel à write les garde contiguës dans le fichier, et le tri stable des lecteurs les laisse derrière leur évènement
+void tracer_plages(uint8_t type, int client_id, int amount, bool resultat, uint8_t flags, const char *plages) {
+    if (trace_fd < 0) {
+        return;
+    }
+
+    // Chaque plage occupe au moins deux caractères ("a,") d'une commande
+    EvenementTrace evenements[1 + BUFFER_SIZE / 2];
+    int nombre = 1;
+    EvenementTrace *evenement = &evenements[0];
+    memset(evenement, 0, sizeof(*evenement));
+    evenement->timestamp_ns = horodatage_operation != 0 ? horodatage_operation : horodatage_ns();
+    horodatage_operation = 0;
+    evenement->client_id = client_id;
+    evenement->amount = amount;
+    evenement->type = type;
+    evenement->result = resultat;
+    evenement->flags = flags;
+
+    if (plages != NULL) {
+        const char *curseur = plages;
+        Plage plage;
+        while (nombre < (int)(sizeof(evenements) / sizeof(evenements[0])) && lire_plage(&curseur, &plage) > 0) {
+            evenements[nombre++] = (EvenementTrace){ .timestamp_ns = evenement->timestamp_ns, .client_id = plage.debut, .amount = plage.longueur, .type = TRACE_PLAGE };
+        }
+        if (*curseur != '\0') {
+            // Liste illisible (ou trop longue) : le rejeu doit la refuser, sans plages
+            evenement->flags |= TRACE_FLAG_LISTE_INVALIDE;
+            nombre = 1;
+        }
+    }
+
+    ssize_t taille = nombre * sizeof(EvenementTrace);
+    if (write(trace_fd, evenements, taille) != taille) {
+        perror("Erreur lors de l'écriture dans la trace");
+    }
+}
+
+// Méthode permettant d'enregistrer un évènement dans la trace (si elle est activée)
+void tracer(uint8_t type, int client_id, int amount, bool resultat, uint8_t flags) {
+    tracer_plages(type, client_id, amount, resultat, flags, NULL);
+}
+
+// Méthode permettant d'attribuer une plage libre à un client (verrou des ressources déjà pris)
+void attribuer_plage(PoolIdentifiants *pool, BitmapIdentifiants *detenus, Plage plage) {
+    marquer_plage(&pool->libres, plage, false);
+    marquer_plage(detenus, plage, true);
+}
+
+// Méthode permettant de rendre au pool une plage détenue par un client (verrou des ressources déjà pris)
+void rendre_plage(PoolIdentifiants *pool, BitmapIdentifiants *detenus, Plage plage) {
+    marquer_plage(detenus, plage, false);
+    // Les identifiants au-delà de la capacité ne redeviennent pas disponibles
+    if (plage.debut < pool->capacity) {
+        int longueur = plage.debut + plage.longueur <= pool->capacity ? plage.longueur : pool->capacity - plage.debut;
+        marquer_plage(&pool->libres, (Plage){plage.debut, longueur}, true);
+    }
+}
+
+// Méthode permettant d'attribuer des identifiants à un client, les plages attribuées sont écrites dans 'texte' ("IDS a-b,c")
+// Une attribution dont la liste ne tiendrait pas dans 'taille' est refusée : le client doit connaître tous ses identifiants
+int allouer_identifiants(ClientInfo *clientInfo, int quantite, bool contigu, char *texte, size_t taille) {
+    if (quantite <= 0) {
+        return IDENTIFIANTS_REFUSES;
+    }
+
+    // Verrouiller le sémaphore des ressources
+    verrouiller_ressources();
+
+    if (*ressources_available < quantite) {
+        // Déverrouiller le sémaphore des ressources
+        sem_post(semaphore_ressources);
+        return IDENTIFIANTS_REFUSES;
+    }
+    // Une plage contiguë tient toujours dans la réponse
+    if (!contigu && !plages_tiennent(&identifiants->libres, quantite, taille)) {
+        // Déverrouiller le sémaphore des ressources
+        sem_post(semaphore_ressources);
+        return IDENTIFIANTS_LISTE_TROP_LONGUE;
+    }
+
+    BitmapIdentifiants *detenus = identifiants_detenus(clientInfo);
+    ListePlages liste;
+    commencer_liste(&liste, texte, taille);
+
+    if (contigu) {
+        // First-fit : retenir la première plage assez longue
+        int position = 0;
+        int debut;
+        for (;;) {
+            debut = premier_identifiant(&identifiants->libres, position);
+            if (debut < 0) {
+                // Déverrouiller le sémaphore des ressources
+                sem_post(semaphore_ressources);
+                return IDENTIFIANTS_REFUSES;
+            }
+            int longueur = longueur_plage(&identifiants->libres, debut, quantite);
+            if (longueur == quantite) {
+                break;
+            }
+            // L'identifiant suivant la plage est occupé, reprendre la recherche après lui
+            position = debut + longueur + 1;
+        }
+        attribuer_plage(identifiants, detenus, (Plage){debut, quantite});
+        ajouter_plage(&liste, (Plage){debut, quantite});
+    } else {
+        // Les identifiants libres sont au moins aussi nombreux que les ressources disponibles : la recherche aboutit toujours
+        int restant = quantite;
+        int position = 0;
+        while (restant > 0) {
+            int debut = premier_identifiant(&identifiants->libres, position);
+            int longueur = longueur_plage(&identifiants->libres, debut, restant);
+            attribuer_plage(identifiants, detenus, (Plage){debut, longueur});
+            ajouter_plage(&liste, (Plage){debut, longueur});
+            restant -= longueur;
+            position = debut + longueur;
+        }
+    }
+    *ressources_available -= quantite;
+    clientInfo->resources_using += quantite;
+
+    // Déverrouiller le sémaphore des ressources
+    sem_post(semaphore_ressources);
+
+    return IDENTIFIANTS_OK;
+}
+
+// Méthode permettant de libérer des identifiants d'un client
+// Si 'demandes' vaut NULL, les identifiants les plus petits du client sont libérés, les plages libérées sont écrites dans 'texte'
+// Comme pour l'attribution, une libération dont la liste ne tiendrait pas dans 'taille' est refusée
+int liberer_identifiants(ClientInfo *clientInfo, int quantite, const char *demandes, char *texte, size_t taille) {
+    if (quantite <= 0) {
+        return IDENTIFIANTS_REFUSES;
+    }
+
+    // Verrouiller le sémaphore des ressources
+    verrouiller_ressources();
+
+    BitmapIdentifiants *detenus = identifiants_detenus(clientInfo);
+    ListePlages liste;
+    commencer_liste(&liste, texte, taille);
+
+    bool valide = clientInfo->resources_using >= quantite;
+    bool trop_longue = false;
+    if (valide && demandes != NULL) {
+        // Vérifier que le client détient chacun des identifiants demandés
+        // Les plages vérifiées sont retirées du client pour détecter les doublons dans la liste
+        const char *curseur = demandes;
+        Plage plage;
+        int lecture;
+        int total = 0;
+        int retirees = 0;
+        while ((lecture = lire_plage(&curseur, &plage)) > 0) {
+            if (!plage_marquee(detenus, plage)) {
+                break;
+            }
+            marquer_plage(detenus, plage, false);
+            ajouter_plage(&liste, plage);
+            total += plage.longueur;
+            retirees++;
+        }
+        trop_longue = liste_trop_longue(&liste);
+        valide = lecture == 0 && total == quantite && !trop_longue;
+
+        // Relire la liste : rendre les plages au pool, ou au client en cas de refus
+        curseur = demandes;
+        for (int i = 0; i < retirees; i++) {
+            lire_plage(&curseur, &plage);
+            if (valide) {
+                rendre_plage(identifiants, detenus, plage);
+            } else {
+                marquer_plage(detenus, plage, true);
+            }
+        }
+    } else if (valide && !plages_tiennent(detenus, quantite, taille)) {
+        trop_longue = true;
+        valide = false;
+    } else if (valide) {
+        // Rendre les plus petits identifiants détenus par le client
+        int restant = quantite;
+        int position = 0;
+        while (restant > 0) {
+            int debut = premier_identifiant(detenus, position);
+            int longueur = longueur_plage(detenus, debut, restant);
+            rendre_plage(identifiants, detenus, (Plage){debut, longueur});
+            ajouter_plage(&liste, (Plage){debut, longueur});
+            restant -= longueur;
+            position = debut + longueur;
+        }
+    }
+
+    if (valide) {
+        *ressources_available += quantite;
+        clientInfo->resources_using -= quantite;
+    }
+
+    // Déverrouiller le sémaphore des ressources
+    sem_post(semaphore_ressources);
+
+    if (trop_longue) {
+        return IDENTIFIANTS_LISTE_TROP_LONGUE;
+    }
+    return valide ? IDENTIFIANTS_OK : IDENTIFIANTS_REFUSES;
+}
+
+// Méthode permettant de libérer tous les identifiants d'un client (déconnexion)
+void liberer_tous_identifiants(ClientInfo *clientInfo) {
+    // Verrouiller le sémaphore des ressources
+    verrouiller_ressources();
+
+    // Parcourir les plages détenues grâce au résumé du bitmap du client
+    BitmapIdentifiants *detenus = identifiants_detenus(clientInfo);
+    int debut;
+    while ((debut = premier_identifiant(detenus, 0)) >= 0) {
+        rendre_plage(identifiants, detenus, (Plage){debut, longueur_plage(detenus, debut, MAX_RESOURCE_IDS)});
+    }
+    *ressources_available += clientInfo->resources_using;
+    clientInfo->resources_using = 0;
+
+    // Déverrouiller le sémaphore des ressources
+    sem_post(semaphore_ressources);
+}
+
+// Méthode permettant de libérer toutes les ressources détenues par un client (verrou des ressources pris ici)
+void liberer_ressources_detenues(ClientInfo *clientInfo) {
+    // En mode identifiants, rendre chaque identifiant détenu par le client
+    if (options.mode_identifiants) {
+        liberer_tous_identifiants(clientInfo);
+        return;
+    }
+
+    // Récupérer les ressources utilisées par le client
+    int resources_used = clientInfo->resources_using;
+
+    // Libérer les ressources utilisées par le client
+    if (resources_used > 0) {
+        changer_ressources_client(clientInfo, -resources_used);
+    }
+}
+
+// Méthode permettant de libérer les ressources utilisées par un client
+void liberer_ressources_client(int clientPID) {
+    // Récupérer le pointeur du client
+    ClientInfo *clientInfo = get_client_by_pid(clients, clientPID);
+
+    // Libérer les ressources utilisées par le client
+    liberer_ressources_detenues(clientInfo);
+}
+
+// Méthode permettant de placer une échéance à l'indice i du tas des timers (sémaphore déjà verrouillé)
+void placer_timer(TasTimers *tas, int i, EntreeTimer entree) {
+    tas->entries[i] = entree;
+    tas->positions[entree.cle] = i;
+}
+
+// Méthode permettant de remettre à sa place l'échéance d'indice i du tas des timers (sémaphore déjà verrouillé)
+// Retourne son nouvel indice
+int reordonner_timer(TasTimers *tas, int i) {
+    EntreeTimer entree = tas->entries[i];
+
+    // Remonter l'échéance tant qu'elle est plus proche que son parent
+    while (i > 0 && tas->entries[(i - 1) / 2].deadline_ns > entree.deadline_ns) {
+        placer_timer(tas, i, tas->entries[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+
+    // Sinon la descendre tant qu'un enfant est plus proche
+    for (;;) {
+        int enfant = 2 * i + 1;
+        if (enfant >= tas->count) {
+            break;
+        }
+        if (enfant + 1 < tas->count && tas->entries[enfant + 1].deadline_ns < tas->entries[enfant].deadline_ns) {
+            enfant++;
+        }
+        if (tas->entries[enfant].deadline_ns >= entree.deadline_ns) {
+            break;
+        }
+        placer_timer(tas, i, tas->entries[enfant]);
+        i = enfant;
+    }
+
+    placer_timer(tas, i, entree);
+    return i;
+}
+
+// Méthode permettant d'armer l'échéance d'une clé (en remplaçant celle déjà armée), retourne false si le tas est plein
+bool armer_timer(TasTimers *tas, EntreeTimer entree) {
+    // Verrouiller le sémaphore
+    verrouiller_semaphore(&tas->semaphore);
+
+    int i = tas->positions[entree.cle];
+    if (i < 0) {
+        if (tas->count == MAX_TIMERS) {
+            // Déverrouiller le sémaphore
+            sem_post(&tas->semaphore);
+            return false;
+        }
+        // Insérer en bas du tas
+        i = tas->count++;
+    }
+    tas->entries[i] = entree;
+    i = reordonner_timer(tas, i);
+
+    // Déverrouiller le sémaphore
+    sem_post(&tas->semaphore);
+
+    // Réveiller le processus des timers si cette échéance est la plus proche
+    if (i == 0) {
+        sem_post(&tas->reveil);
+    }
+    return true;
+}
+
+// Méthode permettant de retirer l'échéance d'indice i du tas des timers (sémaphore déjà verrouillé)
+void retirer_timer(TasTimers *tas, int i) {
+    tas->positions[tas->entries[i].cle] = -1;
+    EntreeTimer derniere = tas->entries[--tas->count];
+    if (i < tas->count) {
+        tas->entries[i] = derniere;
+        reordonner_timer(tas, i);
+    }
+}
+
+// Méthode permettant d'annuler l'échéance d'une clé si elle est armée
+void annuler_timer(TasTimers *tas, int cle) {
+    // Verrouiller le sémaphore
+    verrouiller_semaphore(&tas->semaphore);
+
+    if (tas->positions[cle] >= 0) {
+        retirer_timer(tas, tas->positions[cle]);
+    }
+
+    // Déverrouiller le sémaphore
+    sem_post(&tas->semaphore);
+}
+
+// Méthode permettant de calculer le temps écoulé depuis la date d'un seau (0 si un autre processus y a écrit une date plus récente)
+uint32_t ecoule_depuis(uint64_t etat, uint32_t maintenant_ms) {
+    uint32_t ecoule_ms = maintenant_ms - (uint32_t)etat;
+    return ecoule_ms > UINT32_MAX / 2 ? 0 : ecoule_ms;
+}
+
+// Méthode permettant de consommer un jeton d'un seau (remplissage de 'debit' jetons/s, au plus 'rafale' jetons)
+// Le seau est mis à jour par compare-and-swap : il peut être partagé entre processus sans verrou
+bool consommer_jeton(uint64_t *etat, int debit, int rafale) {
+    uint64_t plein = (uint64_t)rafale * 1000;
+    uint64_t ancien = __atomic_load_n(etat, __ATOMIC_RELAXED);
+
+    for (;;) {
+        // Relire l'horloge à chaque essai : l'état a pu être daté entre-temps par un autre processus
+        uint32_t maintenant_ms = (uint32_t)(horodatage_ns() / 1000000ULL);
+
+        // Un état nul désigne un seau encore jamais utilisé, donc plein
+        uint64_t jetons = plein;
+        if (ancien != 0) {
+            jetons = (ancien >> 32) + (uint64_t)ecoule_depuis(ancien, maintenant_ms) * debit;
+            if (jetons > plein) {
+                jetons = plein;
+            }
+        }
+
+        bool accepte = jetons >= 1000;
+        if (accepte) {
+            jetons -= 1000;
+        }
+
+        uint64_t nouveau = (jetons << 32) | maintenant_ms;
+        if (__atomic_compare_exchange_n(etat, &ancien, nouveau, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            return accepte;
+        }
+    }
+}
+
+// Méthode permettant de savoir si le seau d'une entrée est inutilisé depuis au moins le temps de le remplir entièrement
+// Un tel seau est plein : l'entrée peut être réattribuée à une autre adresse sans rien changer pour l'ancienne
+bool entree_debit_perimee(const EntreeDebitIP *entree, uint32_t maintenant_ms) {
+    uint64_t etat = __atomic_load_n(&entree->state, __ATOMIC_RELAXED);
+    return etat == 0 || (uint64_t)ecoule_depuis(etat, maintenant_ms) * options.rate_ip >= (uint64_t)options.rate_ip_burst * 1000;
+}
+
+// Méthode permettant de consommer un jeton du seau d'une adresse IP (ip dans l'ordre réseau)
+bool consommer_jeton_ip(TableDebits *table, uint32_t ip) {
+    uint32_t maintenant_ms = (uint32_t)(horodatage_ns() / 1000000ULL);
+    EntreeDebitIP *perimee = NULL;
+    uint32_t occupant_perime = 0;
+
+    // Hachage multiplicatif puis sondage linéaire : les entrées voisines partagent la même ligne de cache
+    uint32_t indice = (uint32_t)(ip * 2654435769U) >> (32 - 18);
+    for (int sonde = 0; sonde < DEBITS_IP_MAX_PROBES; sonde++) {
+        EntreeDebitIP *entree = &table->entries[(indice + sonde) & (DEBITS_IP_SLOTS - 1)];
+        uint32_t occupant = __atomic_load_n(&entree->ip, __ATOMIC_ACQUIRE);
+
+        // Les entrées ne redeviennent jamais libres : l'adresse ne peut pas se trouver après une entrée libre
+        if (occupant == 0) {
+            if (perimee != NULL) {
+                break;
+            }
+            uint32_t libre = 0;
+            if (__atomic_compare_exchange_n(&entree->ip, &libre, ip, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                occupant = ip;
+            } else {
+                occupant = libre;
+            }
+        }
+
+        if (occupant == ip) {
+            return consommer_jeton(&entree->state, options.rate_ip, options.rate_ip_burst);
+        }
+
+        // Retenir la première entrée réattribuable, utilisée si l'adresse n'a pas d'entrée
+        if (perimee == NULL && entree_debit_perimee(entree, maintenant_ms)) {
+            perimee = entree;
+            occupant_perime = occupant;
+        }
+    }
+
+    // Réattribuer l'entrée périmée à cette adresse, avec un seau plein
+    if (perimee != NULL && __atomic_compare_exchange_n(&perimee->ip, &occupant_perime, ip, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&perimee->state, 0, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&table->entrees_recyclees, 1, __ATOMIC_RELAXED);
+        return consommer_jeton(&perimee->state, options.rate_ip, options.rate_ip_burst);
+    }
+
+    // Table saturée autour de cette adresse : ne pas limiter plutôt que rejeter à tort
+    __atomic_fetch_add(&table->ip_non_suivies, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// Méthode permettant de savoir si le serveur limite le débit des clients
+bool debits_necessaires() {
+    return options.rate_session > 0 || options.rate_ip > 0;
+}
+
+// Méthode permettant de générer un jeton de session aléatoire (non nul)
+uint64_t generer_jeton_session() {
+    uint64_t jeton = 0;
+    while (jeton == 0) {
+        if (getrandom(&jeton, sizeof(jeton), 0) != sizeof(jeton)) {
+            perror("Erreur lors de la génération du jeton de session");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return jeton;
+}
+
+// Méthode permettant de libérer les ressources d'une session dont le délai de grâce est écoulé
+void expirer_session(ArrayListClientInfo *list, int client_id) {
+    // Verrouiller le sémaphore
+    verrouiller_semaphore(&list->semaphore);
+
+    // La session a pu être reprise entre-temps : elle n'est alors plus dans la liste
+    for (int i = 0; i < list->clients_limit; i++) {
+        if (list->clients[i].client_id == client_id && !list->clients[i].connected) {
+            printf("Délai de grâce écoulé pour la session du client %d\n", client_id);
+            liberer_ressources_detenues(&list->clients[i]);
+            tracer(TRACE_EXPIRE, client_id, 0, true, 0);
+            retirer_client_index(list, i);
+            break;
+        }
+    }
+
+    // Déverrouiller le sémaphore
+    sem_post(&list->semaphore);
+}
+
+// Méthode permettant de conserver la session d'un client déconnecté pendant le délai de grâce
+bool suspendre_session(ArrayListClientInfo *list, int client_id) {
+    // Verrouiller le sémaphore
+    verrouiller_semaphore(&list->semaphore);
+
+    bool trouve = false;
+    bool armee = false;
+    uint64_t deadline_ns = horodatage_ns() + (uint64_t)options.session_grace * 1000000000ULL;
+    for (int i = 0; i < list->clients_limit; i++) {
+        if (list->clients[i].client_id == client_id) {
+            // Le pid ne désigne plus ce client (il peut être réutilisé par un autre processus)
+            list->clients[i].client_pid = 0;
+            list->clients[i].connected = false;
+            list->clients[i].grace_deadline_ns = deadline_ns;
+            // Armer l'échéance sous le verrou : une reprise ne peut pas la précéder
+            armee = armer_timer(timers, (EntreeTimer){ .deadline_ns = deadline_ns, .client_id = client_id, .type = TIMER_GRACE, .cle = i });
+            trouve = true;
+            break;
+        }
+    }
+
+    // Déverrouiller le sémaphore
+    sem_post(&list->semaphore);
+
+    if (!trouve) {
+        return false;
+    }
+
+    // Sans échéance possible, libérer immédiatement plutôt que conserver indéfiniment
+    if (!armee) {
+        fprintf(stderr, "Tas des échéances plein: délai de grâce annulé pour le client %d\n", client_id);
+        expirer_session(list, client_id);
+    }
+    return true;
+}
+
+// Méthode permettant de transférer au client d'indice 'courant' la session suspendue d'indice 'ancien' (sémaphore déjà verrouillé)
+// Retourne le nombre de ressources détenues par le client après la reprise
+int fusionner_session(ArrayListClientInfo *list, int ancien, int courant) {
+    ClientInfo *session = &list->clients[ancien];
+    ClientInfo *clientInfo = &list->clients[courant];
+
+    // Verrouiller le sémaphore des ressources
+    verrouiller_ressources();
+
+    // Les ressources changent de détenteur sans repasser par le pool
+    if (options.mode_identifiants) {
+        transferer_identifiants(identifiants_detenus(session), identifiants_detenus(clientInfo));
+    }
+    clientInfo->resources_using += session->resources_using;
+    clientInfo->session_token = session->session_token;
+    int detenues = clientInfo->resources_using;
+
+    // Déverrouiller le sémaphore des ressources
+    sem_post(semaphore_ressources);
+
+    retirer_client_index(list, ancien);
+    return detenues;
+}
+
+// Méthode permettant de reprendre une session suspendue à partir de son jeton
+// Retourne le nombre de ressources détenues après la reprise, ou -1 si aucune session suspendue ne correspond
+int reprendre_session(ArrayListClientInfo *list, int client_id, uint64_t jeton, int *ancien_client_id) {
+    // Verrouiller le sémaphore
+    verrouiller_semaphore(&list->semaphore);
+
+    int ancien = -1;
+    int courant = -1;
+    for (int i = 0; i < list->clients_limit; i++) {
+        if (list->clients[i].client_id != 0 && !list->clients[i].connected && list->clients[i].session_token == jeton) {
+            ancien = i;
+        } else if (list->clients[i].client_id == client_id) {
+            courant = i;
+        }
+    }
+
+    int detenues = -1;
+    if (ancien >= 0 && courant >= 0) {
+        *ancien_client_id = list->clients[ancien].client_id;
+        detenues = fusionner_session(list, ancien, courant);
+        // L'échéance de grâce de la session reprise ne doit pas occuper le tas jusqu'à son terme
+        annuler_timer(timers, ancien);
+    }
 
-// Méthode permettant de libérer les ressources utilisées par un client
-void liberer_ressources_client(int clientPID) {
-    // Récupérer le pointeur du client
-    ClientInfo *clientInfo = get_client_by_pid(clients, clientPID);
+    // Déverrouiller le sémaphore
+    sem_post(&list->semaphore);
+    return detenues;
+}
 
-    // Récupérer les ressources utilisées par le client
-    int resources_used = clientInfo->resources_using;
+// Méthode permettant de fermer une session logique, en la conservant pendant le délai de grâce si 'grace' est vrai
+void fermer_session(ArrayListClientInfo *list, int client_id, bool grace) {
+    ClientInfo *clientInfo = get_client_by_id(list, client_id);
+    if (clientInfo == NULL) {
+        return;
+    }
 
-    // Libérer les ressources utilisées par le client
-    if (resources_used > 0) {
-        changer_ressources_client(clientInfo, -resources_used);
+    // Conserver les ressources du client pendant le délai de grâce pour permettre une reprise de session
+    if (grace && options.session_grace > 0 && clientInfo->resources_using > 0 && suspendre_session(list, client_id)) {
+        tracer(TRACE_DISCONNECT, client_id, 0, true, TRACE_FLAG_GRACE);
+    } else {
+        // Libérer les ressources utilisées par le client
+        liberer_ressources_detenues(clientInfo);
+        tracer(TRACE_DISCONNECT, client_id, 0, true, grace ? 0 : TRACE_FLAG_CLOSE);
+        // Retirer le client de la liste des clients
+        retirer_client_by_id(list, client_id);
     }
 }
 
 // Méthode permettant de fermer une socket client
 void fermer_socket_client(int socket, ArrayListClientInfo *list, int clientPID) {
-    // Libérer les ressources utilisées par le client
-    liberer_ressources_client(clientPID);
-    // Retirer le client de la liste des clients
-    retirer_client(list, clientPID);
+    // Relever les sessions logiques portées par la connexion
+    int sessions[MAX_SESSIONS];
+    int nombre_sessions = 0;
+    int slot = -1;
+    verrouiller_semaphore(&list->semaphore);
+    for (int i = 0; i < list->clients_limit; i++) {
+        if (list->clients[i].client_pid == clientPID) {
+            sessions[nombre_sessions++] = list->clients[i].client_id;
+        }
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (list->connections[i].pid == clientPID) {
+            slot = i;
+            break;
+        }
+    }
+    sem_post(&list->semaphore);
+
+    // Fermer chaque session logique
+    for (int i = 0; i < nombre_sessions; i++) {
+        fermer_session(list, sessions[i], true);
+    }
+    if (slot >= 0) {
+        liberer_connexion(list, slot);
+    }
+
     // Fermer la socket client
     fermer_socket(socket);
 }
@@ -338,79 +1497,370 @@ void envoyer_reponse(int socket, const char *reponse, ArrayListClientInfo *list,
     }
 }
 
-// Méthode permettant de recevoir une commande du client et la retourner
-char *recevoir_commande(int socket, ArrayListClientInfo *list, int clientPID) {
-    char buffer[BUFFER_SIZE];
-    int bytes_received;
+// Méthode permettant d'envoyer la réponse à une commande en reprenant son préfixe de session et sa fin de ligne
+void envoyer_reponse_commande(int socket, const CommandeClient *commande, const char *reponse, ArrayListClientInfo *list, int clientPID) {
+    if (!commande->prefixe && !commande->ligne) {
+        envoyer_reponse(socket, reponse, list, clientPID);
+        return;
+    }
 
-    printf("Attente de la commande du client...\n");
-    if ((bytes_received = recv(socket, buffer, BUFFER_SIZE, 0)) < 0) {
-        perror("Échec de la réception");
-        fermer_socket_client(socket, list, clientPID);
-        exit(EXIT_FAILURE);
-    } else if (bytes_received == 0) {
-        printf("Le client a fermé la connexion\n");
-        fermer_socket_client(socket, list, clientPID);
-        exit(EXIT_FAILURE);
+    char buffer[BUFFER_SIZE + 32];
+    if (commande->prefixe) {
+        snprintf(buffer, sizeof(buffer), "@%d %s%s", commande->session_id, reponse, commande->ligne ? "\n" : "");
     } else {
-        printf("Commande reçue !\n");
+        snprintf(buffer, sizeof(buffer), "%s\n", reponse);
     }
+    envoyer_reponse(socket, buffer, list, clientPID);
+}
+
+// Méthode permettant de recevoir une commande du client et la retourner
+// Les commandes terminées par '\n' peuvent arriver groupées ou découpées, sinon chaque réception est une commande
+char *recevoir_commande(int socket, ArrayListClientInfo *list, int clientPID, TamponReception *tampon, bool *ligne) {
+    for (;;) {
+        // Extraire une ligne complète si le tampon en contient une
+        char *fin = memchr(tampon->data, '\n', tampon->length);
+        if (fin != NULL) {
+            tampon->mode_lignes = true;
+            int longueur = fin - tampon->data;
+            char *commande = strndup(tampon->data, longueur > 0 && tampon->data[longueur - 1] == '\r' ? longueur - 1 : longueur);
+            tampon->length -= longueur + 1;
+            memmove(tampon->data, fin + 1, tampon->length);
+            *ligne = true;
+            printf("Commande du client: \"%s\"\n", commande);
+            return commande;
+        }
+
+        // Sans fin de ligne, la réception entière forme la commande
+        if (tampon->length > 0 && !tampon->mode_lignes) {
+            char *commande = strndup(tampon->data, tampon->length);
+            tampon->length = 0;
+            *ligne = false;
+            printf("Commande du client: \"%s\"\n", commande);
+            return commande;
+        }
 
-    buffer[bytes_received] = '\0';
-    printf("Commande du client: \"%s\"\n", buffer);
+        // Ligne trop longue : l'ignorer
+        if (tampon->length == BUFFER_SIZE) {
+            tampon->length = 0;
+        }
+
+        // Connexion jugée inactive par le processus des timers (signal reçu hors de recv)
+        if (inactivite_detectee) {
+            printf("Connexion inactive, fermeture\n");
+            fermer_socket_client(socket, list, clientPID);
+            exit(EXIT_FAILURE);
+        }
 
-    return strdup(buffer);
+        int bytes_received;
+        printf("Attente de la commande du client...\n");
+        if ((bytes_received = recv(socket, tampon->data + tampon->length, BUFFER_SIZE - tampon->length, 0)) < 0) {
+            // Interrompu par SIGUSR1 : la connexion est traitée comme inactive au tour suivant
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Échec de la réception");
+            fermer_socket_client(socket, list, clientPID);
+            exit(EXIT_FAILURE);
+        } else if (bytes_received == 0) {
+            printf("Le client a fermé la connexion\n");
+            fermer_socket_client(socket, list, clientPID);
+            exit(EXIT_FAILURE);
+        } else {
+            printf("Commande reçue !\n");
+        }
+        tampon->length += bytes_received;
+    }
 }
 
-// Méthode permettant de gérer un client
-void handle_client(int client_sock, const char *client_ip, int client_port) {
-    // Récupérer le pid du client
-    int client_pid = getpid();
+// Méthode permettant de retrouver une session logique déjà ouverte sur la connexion (NULL si elle n'existe pas)
+SessionLogique *trouver_session_logique(SessionLogique *sessions, int nombre_sessions, int session_id) {
+    for (int i = 0; i < nombre_sessions; i++) {
+        if (sessions[i].session_id == session_id) {
+            return &sessions[i];
+        }
+    }
+    return NULL;
+}
+
+// Méthode permettant de retrouver une session logique de la connexion, en la créant à sa première utilisation
+SessionLogique *ouvrir_session_logique(SessionLogique *sessions, int *nombre_sessions, int session_id, int client_pid, const char *client_ip, int client_port) {
+    SessionLogique *session = trouver_session_logique(sessions, *nombre_sessions, session_id);
+    if (session != NULL) {
+        return session;
+    }
+
+    if (*nombre_sessions == options.max_sessions_per_connection) {
+        return NULL;
+    }
 
     // Créer un objet ClientInfo et l'ajouter à la liste des clients
     ClientInfo clientInfoInst;
     clientInfoInst.client_pid = client_pid;
+    clientInfoInst.client_id = 0;
+    clientInfoInst.session_id = session_id;
     clientInfoInst.resources_using = 0;
     strcpy(clientInfoInst.client_ip, client_ip);
     clientInfoInst.client_port = client_port;
+    clientInfoInst.session_token = generer_jeton_session();
+    clientInfoInst.connected = true;
+    clientInfoInst.grace_deadline_ns = 0;
 
     // Ajouter le client à la liste des clients
-    ajouter_client(clients, clientInfoInst);
+    int client_id = ajouter_client(clients, clientInfoInst);
+    if (client_id == 0) {
+        return NULL;
+    }
+    tracer(TRACE_CONNECT, client_id, session_id == 0 ? 0 : sessions[0].client_id, true, 0);
+
+    sessions[*nombre_sessions] = (SessionLogique){ session_id, client_id, 0 };
+    return &sessions[(*nombre_sessions)++];
+}
+
+// Méthode permettant de savoir si une commande est reconnue, avant de lui ouvrir une session
+bool commande_reconnue(const char *commande) {
+    int quantite;
+    uint64_t jeton;
+    return strncmp(commande, "CLOSE", 5) == 0 || strncmp(commande, "SESSION", 7) == 0 || sscanf(commande, "RESUME %" SCNx64, &jeton) == 1 || sscanf(commande, "REQUEST %d", &quantite) == 1 || sscanf(commande, "RELEASE %d", &quantite) == 1;
+}
+
+// Méthode permettant de gérer le signal SIGUSR1 (connexion jugée inactive par le processus des timers)
+void handle_sigusr1(int sig) {
+    (void)sig;
+    inactivite_detectee = 1;
+}
+
+// Méthode permettant de gérer un client
+void handle_client(int client_sock, int slot, const char *client_ip, int client_port) {
+    // Récupérer le pid du client
+    int client_pid = getpid();
+
+    // Rattacher la connexion réservée par le père à ce processus
+    verrouiller_semaphore(&clients->semaphore);
+    clients->connections[slot].pid = client_pid;
+    sem_post(&clients->semaphore);
+    ConnexionInfo *connexion = &clients->connections[slot];
+
+    // Sessions logiques portées par la connexion, la session 0 est créée dès la connexion
+    SessionLogique sessions[MAX_SESSIONS_PAR_CONNEXION];
+    int nombre_sessions = 0;
+    if (ouvrir_session_logique(sessions, &nombre_sessions, 0, client_pid, client_ip, client_port) == NULL) {
+        fermer_socket_client(client_sock, clients, client_pid);
+        exit(EXIT_FAILURE);
+    }
+
+    // Adresse IP pour le seau à jetons partagé
+    uint32_t ip = inet_addr(client_ip);
+    TamponReception tampon = { .length = 0, .mode_lignes = false };
 
     for (;;) {
-        char *commande = recevoir_commande(client_sock, clients, client_pid);
+        CommandeClient requete = { .session_id = 0, .prefixe = false };
+        char *texte = recevoir_commande(client_sock, clients, client_pid, &tampon, &requete.ligne);
+        char *commande = texte;
+
+        // Repousser l'échéance d'inactivité : simple écriture, le processus des timers la relit à l'expiration
+        if (options.idle_timeout > 0) {
+            __atomic_store_n(&connexion->last_activity_ns, horodatage_ns(), __ATOMIC_RELAXED);
+        }
+
+        // Débiter l'adresse IP dès la réception, avant toute analyse : même une commande invalide est comptée
+        // Le refus n'est envoyé qu'après la lecture du préfixe, pour que la réponse porte la bonne session
+        bool debit_ip_depasse = options.rate_ip > 0 && !consommer_jeton_ip(debits, ip);
+
+        // Session logique désignée par le préfixe "@<id> "
+        if (commande[0] == '@') {
+            char *fin;
+            long session_id = strtol(commande + 1, &fin, 10);
+            if (fin == commande + 1 || session_id < 0 || session_id > INT32_MAX) {
+                if (debit_ip_depasse) {
+                    __atomic_fetch_add(&debits->rejets_ip, 1, __ATOMIC_RELAXED);
+                }
+                envoyer_reponse_commande(client_sock, &requete, debit_ip_depasse ? "DENIED 0, REASON: Limite de débit de l'adresse IP dépassée" : "DENIED 0, REASON: Session invalide", clients, client_pid);
+                free(texte);
+                continue;
+            }
+            requete.session_id = (int)session_id;
+            requete.prefixe = true;
+            commande = fin;
+            while (*commande == ' ') {
+                commande++;
+            }
+        }
+        requete.texte = commande;
+
+        // Limiter le débit de l'adresse IP avant toute recherche ou création de session
+        if (debit_ip_depasse) {
+            __atomic_fetch_add(&debits->rejets_ip, 1, __ATOMIC_RELAXED);
+            envoyer_reponse_commande(client_sock, &requete, "DENIED 0, REASON: Limite de débit de l'adresse IP dépassée", clients, client_pid);
+            free(texte);
+            continue;
+        }
+
+        SessionLogique *session = trouver_session_logique(sessions, nombre_sessions, requete.session_id);
+
+        // Battement de cœur : répondre sans créer de session, le jeton de la session est consommé si elle existe déjà
+        if (strcmp(commande, "PING") == 0) {
+            if (session != NULL && options.rate_session > 0 && !consommer_jeton(&session->seau, options.rate_session, options.rate_session_burst)) {
+                __atomic_fetch_add(&debits->rejets_session, 1, __ATOMIC_RELAXED);
+                envoyer_reponse_commande(client_sock, &requete, "DENIED 0, REASON: Limite de débit de la session dépassée", clients, client_pid);
+            } else {
+                envoyer_reponse_commande(client_sock, &requete, "PONG", clients, client_pid);
+            }
+            free(texte);
+            continue;
+        }
+
+        // N'ouvrir une session que pour une commande reconnue, et jamais pour la fermer
+        if (session == NULL && !commande_reconnue(commande)) {
+            envoyer_reponse_commande(client_sock, &requete, "DENIED 0, REASON: Commande inconnue", clients, client_pid);
+            free(texte);
+            continue;
+        }
+        if (session == NULL && strncmp(commande, "CLOSE", 5) == 0) {
+            envoyer_reponse_commande(client_sock, &requete, "DENIED 0, REASON: Session inconnue", clients, client_pid);
+            free(texte);
+            continue;
+        }
+        if (session == NULL) {
+            session = ouvrir_session_logique(sessions, &nombre_sessions, requete.session_id, client_pid, client_ip, client_port);
+        }
+        if (session == NULL) {
+            envoyer_reponse_commande(client_sock, &requete, "DENIED 0, REASON: Nombre maximal de sessions atteint", clients, client_pid);
+            free(texte);
+            continue;
+        }
+
+        // Limiter le débit de la session avant l'analyse de la commande et tout verrou
+        if (options.rate_session > 0 && !consommer_jeton(&session->seau, options.rate_session, options.rate_session_burst)) {
+            __atomic_fetch_add(&debits->rejets_session, 1, __ATOMIC_RELAXED);
+            envoyer_reponse_commande(client_sock, &requete, "DENIED 0, REASON: Limite de débit de la session dépassée", clients, client_pid);
+            free(texte);
+            continue;
+        }
 
         // Récupérer le pointeur du client
-        ClientInfo *clientInfo = get_client_by_pid(clients, client_pid);
+        int client_id = session->client_id;
+        ClientInfo *clientInfo = get_client_by_id(clients, client_id);
 
         int requested_amount;
-        if (sscanf(commande, "REQUEST %d", &requested_amount) == 1) {
+        int fin_quantite;
+        char liste[TAILLE_LISTE_PLAGES];
+        uint64_t jeton;
+        if (strncmp(commande, "CLOSE", 5) == 0) {
+            // Fermer une session logique en libérant ses ressources (la session 0 se ferme avec la connexion)
+            if (requete.session_id == 0) {
+                envoyer_reponse_commande(client_sock, &requete, "DENIED 0, REASON: La session 0 se ferme avec la connexion", clients, client_pid);
+            } else {
+                fermer_session(clients, client_id, false);
+                *session = sessions[--nombre_sessions];
+                envoyer_reponse_commande(client_sock, &requete, "CLOSED", clients, client_pid);
+            }
+        } else if (strncmp(commande, "SESSION", 7) == 0) {
+            // Communiquer au client son jeton de session et le délai de grâce
+            char buffer[BUFFER_SIZE];
+            snprintf(buffer, BUFFER_SIZE, "SESSION %016" PRIx64 " %d", clientInfo->session_token, options.session_grace);
+            envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
+        } else if (sscanf(commande, "RESUME %" SCNx64, &jeton) == 1) {
+            // Reprendre les ressources d'une session suspendue
+            int ancien_client_id = 0;
+            int detenues = reprendre_session(clients, client_id, jeton, &ancien_client_id);
+            tracer(TRACE_RESUME, client_id, ancien_client_id, detenues >= 0, 0);
+            char buffer[BUFFER_SIZE];
+            if (detenues >= 0) {
+                snprintf(buffer, BUFFER_SIZE, "RESUMED %d", detenues);
+            } else {
+                snprintf(buffer, BUFFER_SIZE, "DENIED 0, REASON: Session inconnue ou expirée");
+            }
+            envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
+        } else if (options.mode_identifiants && sscanf(commande, "REQUEST %d", &requested_amount) == 1) {
+            // Demander des identifiants (une seule plage si CONTIGUOUS est précisé)
+            char option[16];
+            bool contigu = sscanf(commande, "REQUEST %*d %15s", option) == 1 && strcmp(option, "CONTIGUOUS") == 0;
+            int attribution = allouer_identifiants(clientInfo, requested_amount, contigu, liste, sizeof(liste));
+            tracer(TRACE_REQUEST, client_id, requested_amount, attribution == IDENTIFIANTS_OK, contigu ? TRACE_FLAG_CONTIGU : 0);
+            if (attribution == IDENTIFIANTS_OK) {
+                // Répondre au client OK avec les identifiants attribués
+                char buffer[BUFFER_SIZE];
+                snprintf(buffer, BUFFER_SIZE, "GRANTED %d %s", requested_amount, liste);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
+            } else if (attribution == IDENTIFIANTS_LISTE_TROP_LONGUE) {
+                // Répondre au client KO : les identifiants attribués ne pourraient pas tous lui être communiqués
+                char buffer[BUFFER_SIZE];
+                snprintf(buffer, BUFFER_SIZE, "DENIED %d, REASON: Liste d'identifiants trop longue", requested_amount);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
+            } else {
+                // Répondre au client KO
+                char buffer[BUFFER_SIZE];
+                snprintf(buffer, BUFFER_SIZE, "DENIED %d, REASON: Ressources insuffisantes", requested_amount);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
+            }
+        } else if (options.mode_identifiants && sscanf(commande, "RELEASE %d%n", &requested_amount, &fin_quantite) == 1) {
+            // Demander la libération des identifiants listés (ou des plus petits détenus si aucune liste)
+            // Une liste "IDS ..." doit être valide en entier : sinon la libération est refusée, sans se rabattre sur les plus petits
+            const char *plages = commande + fin_quantite;
+            while (*plages == ' ') {
+                plages++;
+            }
+            bool avec_liste = strncmp(plages, "IDS", 3) == 0;
+            if (avec_liste) {
+                plages += 3;
+                while (*plages == ' ') {
+                    plages++;
+                }
+            }
+            int liberation = liberer_identifiants(clientInfo, requested_amount, avec_liste ? plages : NULL, liste, sizeof(liste));
+            tracer_plages(TRACE_RELEASE, client_id, requested_amount, liberation == IDENTIFIANTS_OK, avec_liste ? TRACE_FLAG_LISTE : 0, avec_liste ? plages : NULL);
+            if (liberation == IDENTIFIANTS_OK) {
+                // Répondre au client OK avec les identifiants libérés
+                char buffer[BUFFER_SIZE];
+                snprintf(buffer, BUFFER_SIZE, "RELEASED %d %s", requested_amount, liste);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
+            } else if (liberation == IDENTIFIANTS_LISTE_TROP_LONGUE) {
+                // Répondre au client KO : les identifiants libérés ne pourraient pas tous lui être communiqués
+                char buffer[BUFFER_SIZE];
+                snprintf(buffer, BUFFER_SIZE, "DENIED %d, REASON: Liste d'identifiants trop longue", requested_amount);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
+            } else {
+                // Répondre au client KO
+                char buffer[BUFFER_SIZE];
+                snprintf(buffer, BUFFER_SIZE, "DENIED %d, REASON: Identifiants non détenus", requested_amount);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
+            }
+        } else if (sscanf(commande, "REQUEST %d", &requested_amount) == 1) {
             // Demander les ressources
-            if (changer_ressources_client(clientInfo, requested_amount)) {
+            bool accorde = changer_ressources_client(clientInfo, requested_amount);
+            tracer(TRACE_REQUEST, client_id, requested_amount, accorde, 0);
+            if (accorde) {
                 // Répondre au client OK
                 char buffer[BUFFER_SIZE];
                 snprintf(buffer, BUFFER_SIZE, "GRANTED %d", requested_amount);
-                envoyer_reponse(client_sock, buffer, clients, client_pid);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
             } else {
                 // Répondre au client KO
                 char buffer[BUFFER_SIZE];
                 snprintf(buffer, BUFFER_SIZE, "DENIED %d, REASON: Ressources insuffisantes", requested_amount);
-                envoyer_reponse(client_sock, buffer, clients, client_pid);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
             }
         } else if (sscanf(commande, "RELEASE %d", &requested_amount) == 1) {
             // Demander la libération des ressources
-            if (changer_ressources_client(clientInfo, -requested_amount)) {
+            bool libere = changer_ressources_client(clientInfo, -requested_amount);
+            tracer(TRACE_RELEASE, client_id, requested_amount, libere, 0);
+            if (libere) {
                 // Répondre au client OK
                 char buffer[BUFFER_SIZE];
                 snprintf(buffer, BUFFER_SIZE, "RELEASED %d", requested_amount);
-                envoyer_reponse(client_sock, buffer, clients, client_pid);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
             } else {
                 // Répondre au client KO
                 char buffer[BUFFER_SIZE];
                 snprintf(buffer, BUFFER_SIZE, "DENIED %d, REASON: Ressources insuffisantes", requested_amount);
-                envoyer_reponse(client_sock, buffer, clients, client_pid);
+                envoyer_reponse_commande(client_sock, &requete, buffer, clients, client_pid);
             }
+        } else {
+            // Toujours répondre : un client qui attend une ligne resterait bloqué
+            envoyer_reponse_commande(client_sock, &requete, "DENIED 0, REASON: Commande inconnue", clients, client_pid);
         }
+
+        free(texte);
     }
 
     // Fermer la socket client
@@ -430,15 +1880,27 @@ void accept_client(int server_socket) {
 
     // Accepter une connexion client
     if ((client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &client_addr_len)) < 0) {
-        perror("Échec de l'acceptation");
+        // Socket serveur non bloquante : la connexion signalée par poll a pu être abandonnée entre-temps
+        if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror("Échec de l'acceptation");
+        }
         return;
     }
 
     // Afficher les informations du client
     printf("Client connecté: %s:%d sock_id=%d\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port), client_socket);
 
-    // Vérifier si le nombre de clients est atteint
-    if (get_clients_count(clients) >= MAX_CLIENTS) {
+    // Rejeter les reconnexions trop fréquentes d'une même adresse IP avant le fork
+    if (options.rate_ip > 0 && !consommer_jeton_ip(debits, client_addr.sin_addr.s_addr)) {
+        __atomic_fetch_add(&debits->rejets_connexion, 1, __ATOMIC_RELAXED);
+        printf("Connexion rejetée: limite de débit de l'adresse IP dépassée\n");
+        fermer_socket(client_socket);
+        return;
+    }
+
+    // Vérifier si le nombre de connexions est atteint
+    int slot = reserver_connexion(clients);
+    if (slot < 0) {
         // Fermer la socket client
         fermer_socket(client_socket);
         return;
@@ -448,15 +1910,37 @@ void accept_client(int server_socket) {
     pid_t pid = fork();
     if (pid < 0) {
         perror("Échec du fork");
+        liberer_connexion(clients, slot);
         fermer_socket(client_socket);
     } else if (pid == 0) {
         // Fermer la socket serveur car le fils ne gère pas le serveur
         close(server_socket);
+        // Le rechargement de la configuration ne concerne que le père
+        signal(SIGHUP, SIG_IGN);
+        close(tube_rechargement[0]);
+        close(tube_rechargement[1]);
+        // Gérer SIGUSR1 (sans SA_RESTART pour interrompre recv et fermer la connexion inactive)
+        struct sigaction act_usr1;
+        act_usr1.sa_handler = handle_sigusr1;
+        sigemptyset(&act_usr1.sa_mask);
+        act_usr1.sa_flags = 0;
+        if (sigaction(SIGUSR1, &act_usr1, NULL) == -1) {
+            perror("sigaction");
+            exit(EXIT_FAILURE);
+        }
         // Le fils gère le client
-        handle_client(client_socket, inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+        handle_client(client_socket, slot, inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
     } else {
         // Fermer la socket client car le père ne gère pas le client
         close(client_socket);
+        // Surveiller l'inactivité de la connexion : une seule échéance par connexion dans le tas partagé
+        if (options.idle_timeout > 0) {
+            uint64_t deadline_ns = horodatage_ns() + (uint64_t)options.idle_timeout * 1000000000ULL;
+            EntreeTimer entree = { .deadline_ns = deadline_ns, .client_id = slot, .type = TIMER_INACTIVITE, .generation = clients->connections[slot].generation, .cle = MAX_SESSIONS + slot };
+            if (!armer_timer(timers, entree)) {
+                printf("Tas des échéances plein: inactivité de la connexion non surveillée\n");
+            }
+        }
     }
 }
 
@@ -470,11 +1954,21 @@ void handle_status() {
         struct tm tm = *localtime(&t);
         printf(" --- STATUS DU SERVEUR (%02d/%02d/%04d %02d:%02d:%02d) ---\n", tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
         printf("Ressources disponibles: %d\n", *ressources_available);
-        printf("Clients connectés: %d\n", clients->clients_count);
+        printf("Clients connectés: %d (sessions: %d)\n", clients->connections_count, clients->clients_count);
         // Afficher les informations des clients
-        for (int i = 0; i < clients->clients_count; i++) {
+        for (int i = 0; i < clients->clients_limit; i++) {
             ClientInfo *clientInfo = &clients->clients[i];
-            printf("Client %d: %s:%d, ressources utilisées: %d\n", clientInfo->client_pid, clientInfo->client_ip, clientInfo->client_port, clientInfo->resources_using);
+            if (clientInfo->client_id == 0) {
+                continue;
+            }
+            printf("Client %d (session %d): %s:%d, ressources utilisées: %d%s\n", clientInfo->client_pid, clientInfo->session_id, clientInfo->client_ip, clientInfo->client_port, clientInfo->resources_using, clientInfo->connected ? "" : " (déconnecté, en attente de reprise)");
+        }
+        // Afficher les rejets dus aux limites de débit
+        if (debits_necessaires()) {
+            printf("Rejets (limite de débit): session %" PRIu64 ", IP %" PRIu64 ", connexions %" PRIu64 ", IP non suivies %" PRIu64 ", entrées recyclées %" PRIu64 "\n",
+                   __atomic_load_n(&debits->rejets_session, __ATOMIC_RELAXED), __atomic_load_n(&debits->rejets_ip, __ATOMIC_RELAXED),
+                   __atomic_load_n(&debits->rejets_connexion, __ATOMIC_RELAXED), __atomic_load_n(&debits->ip_non_suivies, __ATOMIC_RELAXED),
+                   __atomic_load_n(&debits->entrees_recyclees, __ATOMIC_RELAXED));
         }
 
         // Attendre 5 secondes
@@ -482,6 +1976,96 @@ void handle_status() {
     }
 }
 
+// Méthode permettant de vérifier l'inactivité d'une connexion dont l'échéance est arrivée à son terme
+// L'échéance n'est pas déplacée à chaque commande : elle est reprogrammée ici d'après la dernière activité
+void verifier_inactivite(int slot, uint32_t generation) {
+    // Verrouiller le sémaphore
+    verrouiller_semaphore(&clients->semaphore);
+    ConnexionInfo connexion = clients->connections[slot];
+    // Déverrouiller le sémaphore
+    sem_post(&clients->semaphore);
+
+    // Connexion fermée depuis l'armement : l'échéance est périmée
+    if (connexion.pid == 0 || connexion.generation != generation) {
+        return;
+    }
+
+    uint64_t maintenant = horodatage_ns();
+    uint64_t delai_ns = (uint64_t)options.idle_timeout * 1000000000ULL;
+    uint64_t deadline_ns = __atomic_load_n(&clients->connections[slot].last_activity_ns, __ATOMIC_RELAXED) + delai_ns;
+    if (connexion.pid > 0 && deadline_ns <= maintenant) {
+        // Interrompre le fils bloqué dans recv, il ferme ses sessions (avec délai de grâce) puis se termine
+        printf("Connexion inactive depuis %d s (pid %d), fermeture\n", options.idle_timeout, connexion.pid);
+        kill(connexion.pid, SIGUSR1);
+        // Renvoyer le signal plus tard si le fils ne s'est pas terminé entre-temps
+        deadline_ns = maintenant + 1000000000ULL;
+    } else if (deadline_ns <= maintenant) {
+        // Fork pas encore terminé : vérifier à nouveau un peu plus tard
+        deadline_ns = maintenant + 1000000000ULL;
+    }
+
+    // Réarmer sous le verrou des clients en revérifiant la génération : si l'emplacement a été réattribué depuis la
+    // vérification, l'échéance de la nouvelle connexion (même clé) ne doit pas être remplacée par celle-ci
+    verrouiller_semaphore(&clients->semaphore);
+    if (clients->connections[slot].pid != 0 && clients->connections[slot].generation == generation) {
+        armer_timer(timers, (EntreeTimer){ .deadline_ns = deadline_ns, .client_id = slot, .type = TIMER_INACTIVITE, .generation = generation, .cle = MAX_SESSIONS + slot });
+    }
+    // Déverrouiller le sémaphore
+    sem_post(&clients->semaphore);
+}
+
+// Méthode permettant de traiter une échéance arrivée à son terme
+void traiter_timer(EntreeTimer timer) {
+    if (timer.type == TIMER_GRACE) {
+        expirer_session(clients, timer.client_id);
+    } else if (timer.type == TIMER_INACTIVITE) {
+        verifier_inactivite(timer.client_id, timer.generation);
+    }
+}
+
+// Méthode permettant de gérer les échéances de tous les clients dans un seul processus
+void handle_timers() {
+    for (;;) {
+        // Verrouiller le sémaphore
+        verrouiller_semaphore(&timers->semaphore);
+
+        if (timers->count == 0) {
+            // Déverrouiller le sémaphore et attendre l'ajout d'une échéance
+            sem_post(&timers->semaphore);
+            sem_wait(&timers->reveil);
+            continue;
+        }
+
+        EntreeTimer prochain = timers->entries[0];
+        uint64_t maintenant = horodatage_ns();
+        if (prochain.deadline_ns > maintenant) {
+            // Déverrouiller le sémaphore et attendre l'échéance (ou l'ajout d'une échéance plus proche)
+            sem_post(&timers->semaphore);
+            uint64_t attente = prochain.deadline_ns - maintenant;
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += attente / 1000000000ULL;
+            ts.tv_nsec += attente % 1000000000ULL;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            sem_timedwait(&timers->reveil, &ts);
+            continue;
+        }
+
+        // Retirer l'échéance du tas puis la traiter sans garder le verrou
+        retirer_timer(timers, 0);
+        sem_post(&timers->semaphore);
+        traiter_timer(prochain);
+    }
+}
+
+// Méthode permettant de savoir si le serveur utilise des échéances
+bool timers_necessaires() {
+    return options.session_grace > 0 || options.idle_timeout > 0;
+}
+
 // Méthode permettant de gérer le signal SIGINT
 void handle_sigint(int sig) {
     // Fermer le serveur
@@ -492,35 +2076,352 @@ void handle_sigint(int sig) {
     sem_destroy(&clients->semaphore);
     fermer_segment_memoire_partagee(&shm_fd_ressources_available, &shm_region_ressources_available, SHM_RESSOURCES_AVAILABLE_NAME, sizeof(int));
     fermer_segment_memoire_partagee(&shm_fd_clients, &shm_region_clients, SHM_CLIENTS_NAME, sizeof(ArrayListClientInfo));
+    if (options.mode_identifiants) {
+        fermer_segment_memoire_partagee(&shm_fd_identifiants, &shm_region_identifiants, SHM_IDENTIFIANTS_NAME, sizeof(PoolIdentifiants));
+    }
+    if (timers_necessaires()) {
+        sem_destroy(&timers->semaphore);
+        sem_destroy(&timers->reveil);
+        fermer_segment_memoire_partagee(&shm_fd_timers, &shm_region_timers, SHM_TIMERS_NAME, sizeof(TasTimers));
+    }
+    if (debits_necessaires()) {
+        fermer_segment_memoire_partagee(&shm_fd_debits, &shm_region_debits, SHM_DEBITS_NAME, sizeof(TableDebits));
+    }
+    if (trace_fd >= 0) {
+        close(trace_fd);
+    }
     exit(EXIT_SUCCESS);
 }
 
+// Méthode permettant de gérer le signal SIGHUP (rechargement de la configuration)
+void handle_sighup(int sig) {
+    (void)sig;
+    // Réveiller la boucle principale même si le signal arrive juste avant son attente
+    int errno_sauve = errno;
+    if (write(tube_rechargement[1], "R", 1) < 0) {
+        // Tube plein : un rechargement est déjà en attente
+    }
+    errno = errno_sauve;
+}
+
+// Méthode permettant de convertir une valeur de configuration en entier (faux si elle n'est pas entièrement numérique)
+bool lire_entier(const char *valeur, int *resultat) {
+    char *fin;
+    errno = 0;
+    long nombre = strtol(valeur, &fin, 10);
+    // Tolérer les espaces (et le retour chariot) en fin de ligne
+    while (isspace((unsigned char)*fin)) {
+        fin++;
+    }
+    if (fin == valeur || *fin != '\0' || errno == ERANGE || nombre < INT_MIN || nombre > INT_MAX) {
+        return false;
+    }
+    *resultat = (int)nombre;
+    return true;
+}
+
 // Méthode permettant de lire un fichier de configuration
-void lireFichierConfig(const char *fichier, int *server_port, int *resource_amount) {
+// Retourne faux si le fichier ne peut pas être ouvert ou contient une valeur invalide (les erreurs sont affichées)
+bool lireFichierConfig(const char *fichier, int *server_port, int *resource_amount, OptionsServeur *options_serveur) {
     FILE *fichier_config = fopen(fichier, "r");
     if (fichier_config == NULL) {
         perror("Erreur lors de l'ouverture du fichier de configuration");
-        exit(EXIT_FAILURE);
+        return false;
     }
 
+    bool valide = true;
+
     char ligne[BUFFER_SIZE];
     while (fgets(ligne, BUFFER_SIZE, fichier_config) != NULL) {
         char clef[BUFFER_SIZE];
         char valeur[BUFFER_SIZE];
         if (sscanf(ligne, "%[^=]=%[^\n]", clef, valeur) == 2) {
+            bool numerique = true;
             if (strcmp(clef, "server_port") == 0) {
-                *server_port = atoi(valeur);
+                numerique = lire_entier(valeur, server_port);
             } else if (strcmp(clef, "resource_amount") == 0) {
-                *resource_amount = atoi(valeur);
+                numerique = lire_entier(valeur, resource_amount);
+            } else if (strcmp(clef, "resource_mode") == 0) {
+                options_serveur->mode_identifiants = strcmp(valeur, "ids") == 0;
+            } else if (strcmp(clef, "trace_file") == 0) {
+                snprintf(options_serveur->trace_file, sizeof(options_serveur->trace_file), "%s", valeur);
+            } else if (strcmp(clef, "session_grace") == 0) {
+                numerique = lire_entier(valeur, &options_serveur->session_grace);
+            } else if (strcmp(clef, "rate_session") == 0) {
+                numerique = lire_entier(valeur, &options_serveur->rate_session);
+            } else if (strcmp(clef, "rate_session_burst") == 0) {
+                numerique = lire_entier(valeur, &options_serveur->rate_session_burst);
+            } else if (strcmp(clef, "rate_ip") == 0) {
+                numerique = lire_entier(valeur, &options_serveur->rate_ip);
+            } else if (strcmp(clef, "rate_ip_burst") == 0) {
+                numerique = lire_entier(valeur, &options_serveur->rate_ip_burst);
+            } else if (strcmp(clef, "idle_timeout") == 0) {
+                numerique = lire_entier(valeur, &options_serveur->idle_timeout);
+            } else if (strcmp(clef, "max_sessions_per_connection") == 0) {
+                numerique = lire_entier(valeur, &options_serveur->max_sessions_per_connection);
+            }
+
+            if (!numerique) {
+                fprintf(stderr, "Valeur non numérique pour %s dans %s: %s\n", clef, fichier, valeur);
+                valide = false;
             }
         }
     }
 
     fclose(fichier_config);
+    return valide;
+}
+
+// Méthode permettant de changer la capacité du pool sans interrompre les clients
+// Les ressources déjà accordées ne sont jamais reprises : en cas de réduction, les ressources disponibles peuvent
+// devenir négatives et les nouvelles demandes sont refusées jusqu'à ce que les libérations résorbent l'excédent
+void redimensionner_ressources(int nouvelle_capacite) {
+    // Verrouiller le sémaphore des ressources
+    verrouiller_ressources();
+
+    int ancienne_capacite = resources_amount;
+    *ressources_available += nouvelle_capacite - ancienne_capacite;
+    resources_amount = nouvelle_capacite;
+
+    if (options.mode_identifiants) {
+        identifiants->capacity = nouvelle_capacite;
+        if (nouvelle_capacite > ancienne_capacite) {
+            // Rendre disponibles les nouveaux identifiants (sauf ceux encore détenus depuis une réduction précédente)
+            for (int position = ancienne_capacite; position < nouvelle_capacite;) {
+                int mot = position / 64;
+                int nombre;
+                uint64_t masque = masque_plage(position, nouvelle_capacite, &nombre);
+                uint64_t detenus = 0;
+                for (int i = 0; i < clients->clients_limit; i++) {
+                    detenus |= identifiants->detenus[i].words[mot];
+                }
+                identifiants->libres.words[mot] |= masque & ~detenus;
+                if (identifiants->libres.words[mot] != 0) {
+                    identifiants->libres.summary[mot / 64] |= 1ULL << (mot % 64);
+                }
+                position += nombre;
+            }
+        } else if (nouvelle_capacite < ancienne_capacite) {
+            // Retirer les identifiants hors capacité, ceux détenus ne redeviendront pas libres à leur libération
+            marquer_plage(&identifiants->libres, (Plage){nouvelle_capacite, ancienne_capacite - nouvelle_capacite}, false);
+        }
+    }
+
+    int disponibles = *ressources_available;
+
+    // Déverrouiller le sémaphore des ressources
+    sem_post(semaphore_ressources);
+
+    tracer(TRACE_RESIZE, 0, nouvelle_capacite, true, 0);
+
+    printf("Capacité modifiée: %d -> %d (ressources disponibles: %d)\n", ancienne_capacite, nouvelle_capacite, disponibles);
+}
+
+// Méthode permettant de relire le fichier de configuration et d'appliquer la nouvelle capacité
+void recharger_configuration() {
+    if (fichier_config == NULL) {
+        printf("Rechargement ignoré: le serveur a été lancé sans fichier de configuration\n");
+        return;
+    }
+
+    // Seule la capacité est appliquée à chaud, les autres options restent celles du démarrage
+    int port = 0;
+    int capacite = resources_amount;
+    OptionsServeur options_lues = options;
+    if (!lireFichierConfig(fichier_config, &port, &capacite, &options_lues)) {
+        fprintf(stderr, "Rechargement ignoré: la configuration actuelle est conservée\n");
+        return;
+    }
+
+    if (capacite < 0 || (options.mode_identifiants && capacite > MAX_RESOURCE_IDS)) {
+        fprintf(stderr, "Rechargement ignoré: resource_amount invalide (%d)\n", capacite);
+        return;
+    }
+    if (capacite != resources_amount) {
+        redimensionner_ressources(capacite);
+    }
+}
+
+// Objet permettant de suivre les ressources détenues par un client d'une trace rejouée
+typedef struct {
+    int client_id;
+    int attendu;
+} SoldeTrace;
+
+// Méthode permettant de rejouer une trace directement sur la comptabilité des ressources (sans réseau ni mémoire partagée)
+void rejouer_trace(const char *fichier) {
+    EnTeteTrace entete;
+    long nombre_evenements;
+    EvenementTrace *evenements = lire_trace(fichier, &entete, &nombre_evenements);
+    uint64_t *latences = malloc(nombre_evenements * sizeof(uint64_t));
+    if (latences == NULL) {
+        fprintf(stderr, "Erreur lors de l'allocation des latences\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Mettre en place la comptabilité dans la mémoire du processus
+    static sem_t semaphore_local;
+    sem_init(&semaphore_local, 0, 1);
+    semaphore_ressources = &semaphore_local;
+    resources_amount = entete.resource_amount;
+    options.mode_identifiants = entete.mode_identifiants;
+    ressources_available = malloc(sizeof(int));
+    *ressources_available = resources_amount;
+    clients = calloc(1, sizeof(ArrayListClientInfo));
+    sem_init(&clients->semaphore, 0, 1);
+    if (options.mode_identifiants) {
+        identifiants = malloc(sizeof(PoolIdentifiants));
+        initialiser_identifiants(identifiants, resources_amount);
+    }
+
+    printf("Rejeu de %ld évènements (capacité %d, mode %s)...\n", nombre_evenements, resources_amount, options.mode_identifiants ? "identifiants" : "quantités");
+
+    // Les clients de la trace sont identifiés par leur client_id, utilisé ici comme pid
+    SoldeTrace soldes[MAX_SESSIONS];
+    int nombre_soldes = 0;
+    int operations = 0;
+    int divergences = 0;
+    char plages[TAILLE_LISTE_PLAGES];
+
+    uint64_t debut_rejeu = horodatage_ns();
+    for (long i = 0; i < nombre_evenements; i++) {
+        EvenementTrace *evenement = &evenements[i];
+        uint64_t debut = horodatage_ns();
+        bool resultat = true;
+
+        if (evenement->type == TRACE_RESIZE) {
+            redimensionner_ressources(evenement->amount);
+        } else if (evenement->type == TRACE_CONNECT) {
+            if (nombre_soldes == MAX_SESSIONS) {
+                divergences++;
+                continue;
+            }
+            ajouter_client(clients, (ClientInfo){ .client_pid = evenement->client_id, .connected = true });
+            soldes[nombre_soldes++] = (SoldeTrace){ evenement->client_id, 0 };
+        } else if (evenement->type == TRACE_DISCONNECT && (evenement->flags & TRACE_FLAG_GRACE)) {
+            // Session conservée : seul l'état change, l'expiration ou la reprise suivra dans la trace
+            ClientInfo *clientInfo = get_client_by_pid(clients, evenement->client_id);
+            if (clientInfo != NULL) {
+                clientInfo->connected = false;
+            }
+        } else if (evenement->type == TRACE_DISCONNECT || evenement->type == TRACE_EXPIRE) {
+            if (get_client_by_pid(clients, evenement->client_id) != NULL) {
+                liberer_ressources_client(evenement->client_id);
+                retirer_client(clients, evenement->client_id);
+            }
+            for (int j = 0; j < nombre_soldes; j++) {
+                if (soldes[j].client_id == evenement->client_id) {
+                    soldes[j] = soldes[--nombre_soldes];
+                    break;
+                }
+            }
+        } else if (evenement->type == TRACE_RESUME) {
+            // Reprendre la session suspendue 'amount' dans le client 'client_id'
+            int ancien = -1;
+            int courant = -1;
+            verrouiller_semaphore(&clients->semaphore);
+            for (int j = 0; j < clients->clients_limit; j++) {
+                if (clients->clients[j].client_id == 0) {
+                    continue;
+                }
+                if (clients->clients[j].client_pid == evenement->amount && !clients->clients[j].connected) {
+                    ancien = j;
+                } else if (clients->clients[j].client_pid == evenement->client_id) {
+                    courant = j;
+                }
+            }
+            resultat = ancien >= 0 && courant >= 0;
+            if (resultat) {
+                fusionner_session(clients, ancien, courant);
+            }
+            sem_post(&clients->semaphore);
+
+            // Transférer le solde attendu
+            if (evenement->result) {
+                int transfere = 0;
+                for (int j = 0; j < nombre_soldes; j++) {
+                    if (soldes[j].client_id == evenement->amount) {
+                        transfere = soldes[j].attendu;
+                        soldes[j] = soldes[--nombre_soldes];
+                        break;
+                    }
+                }
+                for (int j = 0; j < nombre_soldes; j++) {
+                    if (soldes[j].client_id == evenement->client_id) {
+                        soldes[j].attendu += transfere;
+                        break;
+                    }
+                }
+            }
+        } else {
+            // Les plages d'une libération par liste sont consommées avec elle, même si le client est introuvable
+            char demandes[BUFFER_SIZE];
+            if (evenement->type == TRACE_RELEASE && (evenement->flags & TRACE_FLAG_LISTE)) {
+                i = lire_plages_trace(evenements, nombre_evenements, i, demandes, sizeof(demandes));
+            }
+            ClientInfo *clientInfo = get_client_by_pid(clients, evenement->client_id);
+            if (clientInfo == NULL) {
+                divergences++;
+                continue;
+            }
+            bool demande = evenement->type == TRACE_REQUEST;
+            if (options.mode_identifiants && demande) {
+                resultat = allouer_identifiants(clientInfo, evenement->amount, evenement->flags & TRACE_FLAG_CONTIGU, plages, sizeof(plages)) == IDENTIFIANTS_OK;
+            } else if (options.mode_identifiants && (evenement->flags & TRACE_FLAG_LISTE)) {
+                // Libérer exactement les plages enregistrées à la suite de l'évènement
+                resultat = liberer_identifiants(clientInfo, evenement->amount, demandes, plages, sizeof(plages)) == IDENTIFIANTS_OK;
+            } else if (options.mode_identifiants) {
+                resultat = liberer_identifiants(clientInfo, evenement->amount, NULL, plages, sizeof(plages)) == IDENTIFIANTS_OK;
+            } else {
+                resultat = changer_ressources_client(clientInfo, demande ? evenement->amount : -evenement->amount);
+            }
+
+            // Solde attendu d'après le résultat enregistré
+            if (evenement->result) {
+                for (int j = 0; j < nombre_soldes; j++) {
+                    if (soldes[j].client_id == evenement->client_id) {
+                        soldes[j].attendu += demande ? evenement->amount : -evenement->amount;
+                        break;
+                    }
+                }
+            }
+        }
+
+        latences[operations++] = horodatage_ns() - debut;
+        if (resultat != (bool)evenement->result) {
+            divergences++;
+        }
+    }
+    uint64_t duree = horodatage_ns() - debut_rejeu;
+
+    // Comparer l'état final à celui attendu d'après la trace
+    bool etat_equivalent = true;
+    int total_attendu = 0;
+    for (int j = 0; j < nombre_soldes; j++) {
+        ClientInfo *clientInfo = get_client_by_pid(clients, soldes[j].client_id);
+        if (clientInfo == NULL || clientInfo->resources_using != soldes[j].attendu) {
+            etat_equivalent = false;
+        }
+        total_attendu += soldes[j].attendu;
+    }
+    if (*ressources_available != resources_amount - total_attendu) {
+        etat_equivalent = false;
+    }
+
+    afficher_rapport_rejeu(latences, operations, duree, divergences, etat_equivalent);
+
+    free(evenements);
+    free(latences);
 }
 
 // Méthode principale
 int main(int argc, char *argv[]) {
+    // Rejeu d'une trace sur la comptabilité, sans démarrer le serveur
+    if (argc == 3 && strcmp(argv[1], "--replay") == 0) {
+        rejouer_trace(argv[2]);
+        return EXIT_SUCCESS;
+    }
+
     if (argc != 3 && argc != 2) {
         usage(argv[0]);
     }
@@ -531,7 +2432,35 @@ int main(int argc, char *argv[]) {
         resources_amount = atoi(argv[1]);
         port = atoi(argv[2]);
     } else {
-        lireFichierConfig(argv[1], &port, &resources_amount);
+        fichier_config = argv[1];
+        if (!lireFichierConfig(fichier_config, &port, &resources_amount, &options)) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // En mode identifiants, la capacité est limitée par la taille du bitmap
+    if (options.mode_identifiants && (resources_amount < 0 || resources_amount > MAX_RESOURCE_IDS)) {
+        fprintf(stderr, "En mode identifiants, resource_amount doit être compris entre 0 et %d\n", MAX_RESOURCE_IDS);
+        exit(EXIT_FAILURE);
+    }
+
+    // La table des sessions d'une connexion est dimensionnée par MAX_SESSIONS_PAR_CONNEXION
+    if (options.max_sessions_per_connection < 1 || options.max_sessions_per_connection > MAX_SESSIONS_PAR_CONNEXION) {
+        fprintf(stderr, "max_sessions_per_connection doit être compris entre 1 et %d\n", MAX_SESSIONS_PAR_CONNEXION);
+        exit(EXIT_FAILURE);
+    }
+
+    // Une rafale non précisée vaut une seconde de débit
+    if (options.rate_session_burst <= 0) {
+        options.rate_session_burst = options.rate_session;
+    }
+    if (options.rate_ip_burst <= 0) {
+        options.rate_ip_burst = options.rate_ip;
+    }
+    // Les jetons d'un seau sont comptés en millièmes sur les 32 bits de poids fort de son état
+    if (options.rate_session_burst > MAX_RAFALE || options.rate_ip_burst > MAX_RAFALE) {
+        fprintf(stderr, "rate_session_burst et rate_ip_burst (ou le débit qui en tient lieu) ne doivent pas dépasser %d\n", MAX_RAFALE);
+        exit(EXIT_FAILURE);
     }
 
     // Créer un segment de mémoire partagée pour les ressources disponibles
@@ -549,6 +2478,21 @@ int main(int argc, char *argv[]) {
 
     // Initialisation des clients
     clients->clients_count = 0;
+    clients->clients_limit = 0;
+    clients->sessions_logiques_count = 0;
+    memset(clients->clients, 0, sizeof(clients->clients));
+    clients->connections_count = 0;
+    clients->next_client_id = 0;
+    memset(clients->connections, 0, sizeof(clients->connections));
+
+    // En mode identifiants, créer un segment de mémoire partagée pour le bitmap des identifiants
+    if (options.mode_identifiants) {
+        creer_segment_memoire_partagee(&shm_fd_identifiants, &shm_region_identifiants, SHM_IDENTIFIANTS_NAME, sizeof(PoolIdentifiants));
+        // Lier la variable partagée 'identifiants'
+        identifiants = (PoolIdentifiants *)shm_region_identifiants;
+        // Initialisation des identifiants
+        initialiser_identifiants(identifiants, resources_amount);
+    }
 
     // Mise en place du sémaphore des clients
     sem_init(&clients->semaphore, 1, 1); // 1 pour processus multiples
@@ -556,6 +2500,32 @@ int main(int argc, char *argv[]) {
     // Mise en place du sémaphore des ressources
     creer_semaphore(&semaphore_ressources, SEM_RESSOURCES_NAME, 1);
 
+    // Créer un segment de mémoire partagée pour les échéances si nécessaire
+    if (timers_necessaires()) {
+        creer_segment_memoire_partagee(&shm_fd_timers, &shm_region_timers, SHM_TIMERS_NAME, sizeof(TasTimers));
+        // Lier la variable partagée 'timers'
+        timers = (TasTimers *)shm_region_timers;
+        // Initialisation des échéances
+        timers->count = 0;
+        memset(timers->positions, -1, sizeof(timers->positions));
+        sem_init(&timers->semaphore, 1, 1);
+        sem_init(&timers->reveil, 1, 0);
+    }
+
+    // Créer un segment de mémoire partagée pour les limites de débit si nécessaire
+    if (debits_necessaires()) {
+        creer_segment_memoire_partagee(&shm_fd_debits, &shm_region_debits, SHM_DEBITS_NAME, sizeof(TableDebits));
+        // Lier la variable partagée 'débits'
+        debits = (TableDebits *)shm_region_debits;
+        // Initialisation des seaux et des compteurs
+        memset(debits, 0, sizeof(TableDebits));
+    }
+
+    // Ouvrir le fichier de trace si l'enregistrement est demandé
+    if (options.trace_file[0] != '\0') {
+        ouvrir_trace(options.trace_file, resources_amount, options.mode_identifiants);
+    }
+
     // Créer une socket serveur
     server_sock = socket_serveur(port);
 
@@ -573,6 +2543,22 @@ int main(int argc, char *argv[]) {
         exit(EXIT_SUCCESS);
     }
 
+    // Gérer les échéances (délais de grâce) dans un seul processus fils
+    if (timers_necessaires()) {
+        pid_t pid_timers = fork();
+        if (pid_timers < 0) {
+            perror("Échec du fork");
+            fermer_socket(server_sock);
+            exit(EXIT_FAILURE);
+        } else if (pid_timers == 0) {
+            // Le fils ne gère pas le serveur
+            close(server_sock);
+            // Le fils gère les échéances
+            handle_timers();
+            exit(EXIT_SUCCESS);
+        }
+    }
+
     // Gérer SIGINT
     struct sigaction act;
     act.sa_handler = handle_sigint;
@@ -584,8 +2570,47 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    // Gérer SIGHUP : le gestionnaire écrit dans un tube surveillé par poll, qui est interrompu dans tous les cas
+    if (pipe(tube_rechargement) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    fcntl(tube_rechargement[0], F_SETFL, O_NONBLOCK);
+    fcntl(tube_rechargement[1], F_SETFL, O_NONBLOCK);
+    struct sigaction act_hup;
+    act_hup.sa_handler = handle_sighup;
+    sigemptyset(&act_hup.sa_mask);
+    act_hup.sa_flags = SA_RESTART;
+
+    if (sigaction(SIGHUP, &act_hup, NULL) == -1) {
+        perror("sigaction");
+        exit(EXIT_FAILURE);
+    }
+
+    // La socket serveur est non bloquante : accept ne doit jamais empêcher de traiter un rechargement
+    fcntl(server_sock, F_SETFL, O_NONBLOCK);
+
+    struct pollfd attentes[2] = { { server_sock, POLLIN, 0 }, { tube_rechargement[0], POLLIN, 0 } };
     for (;;) {
-        // Attendre une connexion client
-        accept_client(server_sock);
+        // Attendre une connexion client ou une demande de rechargement
+        if (poll(attentes, 2, -1) < 0) {
+            if (errno != EINTR) {
+                perror("Échec de poll");
+            }
+            continue;
+        }
+
+        // Recharger la configuration si demandé (plusieurs SIGHUP rapprochés donnent un seul rechargement)
+        if (attentes[1].revents & POLLIN) {
+            char octets[16];
+            while (read(tube_rechargement[0], octets, sizeof(octets)) > 0) {
+            }
+            recharger_configuration();
+        }
+
+        // Accepter la connexion client
+        if (attentes[0].revents & POLLIN) {
+            accept_client(server_sock);
+        }
     }
 }
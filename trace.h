@@ -0,0 +1,150 @@
+// Format des fichiers de trace, partagé par le serveur (enregistrement, rejeu local) et l'outil de rejeu réseau
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_MAGIC "UTC502TR"
+#define TRACE_VERSION 2
+
+// Types d'évènements enregistrés dans une trace
+enum {
+    TRACE_CONNECT = 1, // amount : client_id de la session 0 de la connexion pour une session logique, 0 sinon
+    TRACE_DISCONNECT = 2,
+    TRACE_REQUEST = 3,
+    TRACE_RELEASE = 4,
+    TRACE_RESUME = 5, // amount : client_id de la session reprise
+    TRACE_EXPIRE = 6,
+    TRACE_RESIZE = 7, // amount : nouvelle capacité du pool, client_id : 0
+    TRACE_PLAGE = 8   // Suit un TRACE_RELEASE avec TRACE_FLAG_LISTE : client_id = premier identifiant, amount = longueur
+};
+
+// Indicateurs d'un évènement de trace
+#define TRACE_FLAG_CONTIGU 0x01
+#define TRACE_FLAG_LISTE 0x02
+#define TRACE_FLAG_GRACE 0x04
+#define TRACE_FLAG_CLOSE 0x08
+#define TRACE_FLAG_LISTE_INVALIDE 0x10 // La liste "IDS ..." n'a pas pu être lue : aucun TRACE_PLAGE ne suit
+
+// Objet permettant de stocker l'en-tête d'un fichier de trace
+typedef struct __attribute__((packed)) {
+    char magic[8];
+    uint32_t version;
+    int32_t resource_amount;
+    uint8_t mode_identifiants;
+    uint8_t reserved[3];
+} EnTeteTrace;
+
+// Objet permettant de stocker un évènement d'un fichier de trace (écrit en un seul appel à write)
+typedef struct __attribute__((packed)) {
+    uint64_t timestamp_ns; // Horloge CLOCK_MONOTONIC
+    int32_t client_id;
+    int32_t amount;
+    uint8_t type;
+    uint8_t result; // 1 si la demande a été acceptée
+    uint8_t flags;
+    uint8_t reserved;
+} EvenementTrace;
+
+// Méthode permettant de trier les évènements par horodatage en conservant l'ordre du fichier à égalité
+// Les processus écrivent après avoir libéré le verrou des ressources : la trace est presque triée, un tri par insertion suffit
+static void trier_trace(EvenementTrace *evenements, long nombre_evenements) {
+    for (long i = 1; i < nombre_evenements; i++) {
+        EvenementTrace evenement = evenements[i];
+        long j = i;
+        while (j > 0 && evenements[j - 1].timestamp_ns > evenement.timestamp_ns) {
+            evenements[j] = evenements[j - 1];
+            j--;
+        }
+        evenements[j] = evenement;
+    }
+}
+
+// Méthode permettant de lire l'en-tête et tous les évènements d'un fichier de trace (quitte si le fichier est invalide)
+// Les évènements sont rendus dans l'ordre de sérialisation des opérations, pas dans l'ordre d'écriture
+static EvenementTrace *lire_trace(const char *fichier, EnTeteTrace *entete, long *nombre_evenements) {
+    FILE *fichier_trace = fopen(fichier, "rb");
+    if (fichier_trace == NULL) {
+        perror("Erreur lors de l'ouverture du fichier de trace");
+        exit(EXIT_FAILURE);
+    }
+
+    // Lire et vérifier l'en-tête
+    if (fread(entete, sizeof(*entete), 1, fichier_trace) != 1 || memcmp(entete->magic, TRACE_MAGIC, sizeof(entete->magic)) != 0 || entete->version != TRACE_VERSION) {
+        fprintf(stderr, "Fichier de trace invalide: %s\n", fichier);
+        exit(EXIT_FAILURE);
+    }
+
+    // Lire tous les évènements avant de mesurer
+    fseek(fichier_trace, 0, SEEK_END);
+    *nombre_evenements = (ftell(fichier_trace) - (long)sizeof(*entete)) / (long)sizeof(EvenementTrace);
+    fseek(fichier_trace, sizeof(*entete), SEEK_SET);
+    EvenementTrace *evenements = malloc(*nombre_evenements * sizeof(EvenementTrace));
+    if (evenements == NULL || fread(evenements, sizeof(EvenementTrace), *nombre_evenements, fichier_trace) != (size_t)*nombre_evenements) {
+        fprintf(stderr, "Erreur lors de la lecture de la trace\n");
+        exit(EXIT_FAILURE);
+    }
+    fclose(fichier_trace);
+
+    trier_trace(evenements, *nombre_evenements);
+    return evenements;
+}
+
+// Méthode permettant de reconstituer la liste "a-b,c" des TRACE_PLAGE qui suivent l'évènement d'indice 'i'
+// Une liste invalide à l'enregistrement est reproduite par un texte invalide, pour être refusée de la même façon
+// Retourne l'indice du dernier enregistrement consommé
+static long lire_plages_trace(const EvenementTrace *evenements, long nombre_evenements, long i, char *texte, size_t taille) {
+    size_t ecrit = 0;
+    texte[0] = '\0';
+    if (evenements[i].flags & TRACE_FLAG_LISTE_INVALIDE) {
+        snprintf(texte, taille, "?");
+    }
+    while (i + 1 < nombre_evenements && evenements[i + 1].type == TRACE_PLAGE) {
+        i++;
+        const EvenementTrace *plage = &evenements[i];
+        const char *separateur = ecrit > 0 ? "," : "";
+        if (ecrit < taille) {
+            if (plage->amount == 1) {
+                ecrit += snprintf(texte + ecrit, taille - ecrit, "%s%d", separateur, plage->client_id);
+            } else {
+                ecrit += snprintf(texte + ecrit, taille - ecrit, "%s%d-%d", separateur, plage->client_id, plage->client_id + plage->amount - 1);
+            }
+        }
+    }
+    return i;
+}
+
+// Méthode permettant de comparer deux latences (tri)
+static int comparer_latences(const void *a, const void *b) {
+    uint64_t la = *(const uint64_t *)a;
+    uint64_t lb = *(const uint64_t *)b;
+    return (la > lb) - (la < lb);
+}
+
+// Méthode permettant d'afficher le rapport d'un rejeu de trace
+static void afficher_rapport_rejeu(uint64_t *latences, int operations, uint64_t duree_ns, int divergences, bool etat_equivalent) {
+    qsort(latences, operations, sizeof(uint64_t), comparer_latences);
+    uint64_t total = 0;
+    for (int i = 0; i < operations; i++) {
+        total += latences[i];
+    }
+
+    printf(" --- RAPPORT DU REJEU ---\n");
+    printf("Opérations: %d en %.3f ms\n", operations, duree_ns / 1e6);
+    printf("Débit: %.0f opérations/s\n", duree_ns > 0 ? operations / (duree_ns / 1e9) : 0.0);
+    if (operations > 0) {
+        printf("Latence (µs): moyenne %.2f, p50 %.2f, p99 %.2f, max %.2f\n",
+               total / (double)operations / 1e3,
+               latences[operations / 2] / 1e3,
+               latences[(int)(operations * 0.99)] / 1e3,
+               latences[operations - 1] / 1e3);
+    }
+    printf("Résultats divergents: %d\n", divergences);
+    printf("État final équivalent: %s\n", etat_equivalent ? "oui" : "non");
+}
+
+#endif